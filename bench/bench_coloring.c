@@ -0,0 +1,115 @@
+/**
+ * @file bench_coloring.c
+ * @author Hrvoje Z
+ * @brief Cache coloring benchmark
+ * @version 0.1
+ * @date 2025-01-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * All blocks of the pool are allocated and the first cache line (header) of
+ * every block is read and written in rounds. With large power of two blocks
+ * packed back to back all headers map to the same cache sets, with coloring
+ * they are spread over them. Time per header touch and L1 data cache read
+ * misses (perf_event_open, reported as n/a when not permitted) are printed.
+ *
+ * Usage: bench_coloring [rounds]
+ */
+
+#define _GNU_SOURCE /* syscall */
+
+/* Standard library includes */
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Files under test includes */
+#include "block.h"
+
+/* Macros and Constants */
+#define BENCH_MAX_BLOCKS (4096U)
+#define BENCH_DEFAULT_ROUNDS (20000U)
+
+/* Static functions */
+
+static double bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + ((double)now.tv_nsec * 1e-9);
+}
+
+static int bench_l1d_misses_open(void)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_L1D |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int main(int argc, char ** argv)
+{
+    size_t rounds = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_ROUNDS;
+    static volatile uint64_t * pHeaders[BENCH_MAX_BLOCKS];
+    size_t numBlocks = 0U;
+    uint64_t misses = 0U;
+    int perfFd = bench_l1d_misses_open();
+
+    block_init();
+    for (void * pBlock = block_alloc(); (NULL != pBlock) && (numBlocks < BENCH_MAX_BLOCKS); pBlock = block_alloc())
+    {
+        pHeaders[numBlocks] = (volatile uint64_t *)pBlock;
+        numBlocks++;
+    }
+
+    /* Warm up, so both layouts start from the same cache state */
+    for (size_t index = 0U; index < numBlocks; index++)
+    {
+        (*pHeaders[index])++;
+    }
+    if (0 <= perfFd)
+    {
+        ioctl(perfFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(perfFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    double start = bench_now();
+    for (size_t round = 0U; round < rounds; round++)
+    {
+        for (size_t index = 0U; index < numBlocks; index++)
+        {
+            (*pHeaders[index])++;
+        }
+    }
+    double elapsed = bench_now() - start;
+    if ((0 <= perfFd) && (sizeof(misses) != read(perfFd, &misses, sizeof(misses))))
+    {
+        misses = 0U;
+    }
+
+    double touches = (double)rounds * (double)numBlocks;
+    printf("# block size: %zu, blocks: %zu, rounds: %zu\n", block_size(), numBlocks, rounds);
+    printf("%14s %16s\n", "ns/touch", "L1D misses/touch");
+    if (0 <= perfFd)
+    {
+        printf("%14.3f %16.3f\n", (elapsed * 1e9) / touches, (double)misses / touches);
+        close(perfFd);
+    }
+    else
+    {
+        printf("%14.3f %16s\n", (elapsed * 1e9) / touches, "n/a");
+    }
+    return 0;
+}
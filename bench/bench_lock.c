@@ -0,0 +1,91 @@
+/**
+ * @file bench_lock.c
+ * @author Hrvoje Z
+ * @brief Lock cost benchmark
+ * @version 0.1
+ * @date 2025-01-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * Single thread allocates and frees one block in a loop, so every operation
+ * pays for lock and atomics of the port without contention. Blocking path
+ * (block_alloc/block_free) and interrupt path (block_try_alloc/block_try_free)
+ * are timed separately. Built against hosted, C11 port and POSIX simulation
+ * of bare-metal port, the difference is the cost of the port hooks.
+ *
+ * Usage: bench_lock [iterations] [max ns/pair]
+ *
+ * With max ns/pair given, exit code is nonzero when either path is slower,
+ * which catches lock cost regressions in CI.
+ */
+
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+
+/* Standard library includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Files under test includes */
+#include "block.h"
+
+/* Macros and Constants */
+#define BENCH_DEFAULT_ITERATIONS (2000000U)
+
+/* Static functions */
+
+static double bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + ((double)now.tv_nsec * 1e-9);
+}
+
+static double bench_blocking(size_t iterations)
+{
+    double start = bench_now();
+    for (size_t iteration = 0U; iteration < iterations; iteration++)
+    {
+        void * pBlock = block_alloc();
+        block_free(pBlock);
+    }
+    return ((bench_now() - start) * 1e9) / (double)iterations;
+}
+
+static double bench_try(size_t iterations)
+{
+    double start = bench_now();
+    for (size_t iteration = 0U; iteration < iterations; iteration++)
+    {
+        void * pBlock = block_try_alloc();
+        block_try_free(pBlock);
+    }
+    return ((bench_now() - start) * 1e9) / (double)iterations;
+}
+
+int main(int argc, char ** argv)
+{
+    size_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_ITERATIONS;
+    double maxNs = (argc > 2) ? strtod(argv[2], NULL) : 0.0;
+    int result = 0;
+
+    block_init();
+    /* Warm up caches and branch predictors */
+    (void)bench_blocking(iterations / 10U + 1U);
+    double blockingNs = bench_blocking(iterations);
+    double tryNs = bench_try(iterations);
+
+    printf("# block size: %zu, iterations: %zu\n", block_size(), iterations);
+    printf("%20s %20s\n", "alloc+free ns/pair", "try alloc+free ns/pair");
+    printf("%20.2f %20.2f\n", blockingNs, tryNs);
+    if ((maxNs > 0.0) && ((blockingNs > maxNs) || (tryNs > maxNs)))
+    {
+        printf("FAIL: above %.2f ns/pair\n", maxNs);
+        result = 1;
+    }
+    else
+    {
+        /* No limit or within limit */
+    }
+    return result;
+}
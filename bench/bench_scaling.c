@@ -0,0 +1,133 @@
+/**
+ * @file bench_scaling.c
+ * @author Hrvoje Z
+ * @brief Allocator thread scaling benchmark
+ * @version 0.1
+ * @date 2025-01-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ * Every thread repeatedly allocates a small working set of blocks, touches
+ * them and frees them again. Throughput is reported for 1, 2, 4 ... threads
+ * up to given maximum (default 64), threads are pinned round robin to CPUs.
+ * 
+ * Usage: bench_scaling [max_threads] [iterations_per_thread]
+ */
+
+#define _GNU_SOURCE /* pthread_setaffinity_np */
+
+/* Standard library includes */
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Files under test includes */
+#include "block.h"
+
+/* Macros and Constants */
+#define BENCH_MAX_THREADS (64U)
+#define BENCH_WORKING_SET (8U)
+#define BENCH_DEFAULT_ITERATIONS (200000U)
+
+/* Type definitions */
+typedef struct
+{
+    size_t cpu;        /* CPU to pin thread to */
+    size_t iterations; /* Number of working set rounds */
+    size_t failures;   /* Allocations that returned NULL */
+} bench_thread_t;
+
+/* Static variables */
+static pthread_barrier_t benchBarrier;
+
+/* Static functions */
+
+static double bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + ((double)now.tv_nsec * 1e-9);
+}
+
+static void * bench_thread(void * pArg)
+{
+    bench_thread_t * pThread = (bench_thread_t *)pArg;
+    void * pBlocks[BENCH_WORKING_SET];
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(pThread->cpu, &cpus);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    pthread_barrier_wait(&benchBarrier);
+    for (size_t round = 0U; round < pThread->iterations; round++)
+    {
+        for (size_t index = 0U; index < BENCH_WORKING_SET; index++)
+        {
+            pBlocks[index] = block_alloc();
+            if (NULL != pBlocks[index])
+            {
+                *(volatile uint8_t *)pBlocks[index] = (uint8_t)round;
+            }
+            else
+            {
+                pThread->failures++;
+            }
+        }
+        for (size_t index = 0U; index < BENCH_WORKING_SET; index++)
+        {
+            block_free(pBlocks[index]);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char ** argv)
+{
+    size_t maxThreads = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_MAX_THREADS;
+    size_t iterations = (argc > 2) ? strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_ITERATIONS;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_t threads[BENCH_MAX_THREADS];
+    bench_thread_t args[BENCH_MAX_THREADS];
+
+    if ((0U == maxThreads) || (maxThreads > BENCH_MAX_THREADS))
+    {
+        maxThreads = BENCH_MAX_THREADS;
+    }
+    cpus = (cpus > 0) ? cpus : 1;
+
+    printf("# online CPUs: %ld, working set: %u blocks, rounds per thread: %zu\n",
+           cpus, BENCH_WORKING_SET, iterations);
+    printf("%8s %14s %14s %10s\n", "threads", "Mops/s", "ns/op/thread", "failures");
+    for (size_t numThreads = 1U; numThreads <= maxThreads; numThreads *= 2U)
+    {
+        size_t failures = 0U;
+        block_init();
+        pthread_barrier_init(&benchBarrier, NULL, (unsigned)numThreads + 1U);
+        for (size_t thread = 0U; thread < numThreads; thread++)
+        {
+            args[thread].cpu = thread % (size_t)cpus;
+            args[thread].iterations = iterations;
+            args[thread].failures = 0U;
+            pthread_create(&threads[thread], NULL, bench_thread, &args[thread]);
+        }
+        pthread_barrier_wait(&benchBarrier);
+        double start = bench_now();
+        for (size_t thread = 0U; thread < numThreads; thread++)
+        {
+            pthread_join(threads[thread], NULL);
+            failures += args[thread].failures;
+        }
+        double elapsed = bench_now() - start;
+        pthread_barrier_destroy(&benchBarrier);
+
+        /* One operation is single alloc or single free */
+        double ops = (double)numThreads * (double)iterations * (double)BENCH_WORKING_SET * 2.0;
+        printf("%8zu %14.2f %14.2f %10zu\n", numThreads, (ops / elapsed) * 1e-6,
+               (elapsed * 1e9 * (double)numThreads) / ops, failures);
+    }
+    return 0;
+}
@@ -0,0 +1,265 @@
+/**
+ * @file bench_wcet.c
+ * @author Hrvoje Z
+ * @brief Worst case execution time benchmark
+ * @version 0.1
+ * @date 2025-01-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * Threads pinned to own CPUs run under SCHED_FIFO (falls back to normal
+ * scheduling when not permitted) and churn a working set of blocks. Every
+ * round half of the set is freed with block_free() and half with
+ * block_try_free(), as an interrupt handler would, then the set is allocated
+ * again. Every call is timed with the cycle counter (nanoseconds where none is
+ * available), maximum per call and log2 histogram of all calls are printed.
+ * After the threads, one pinned thread allocates the working set right after
+ * block_reset_all() of a dirty pool, allocation must not pay for the reset.
+ *
+ * Thread count is limited to online CPUs. Runs longer than RT throttling
+ * budget (/proc/sys/kernel/sched_rt_runtime_us, 0.95 s by default) need it
+ * set to -1, otherwise throttled periods show up as worst case.
+ *
+ * Usage: bench_wcet [rounds per thread] [threads] [max cycles] [trials]
+ *
+ * With max cycles given, exit code is nonzero when worst call of every trial
+ * took longer. Unbounded work of allocator shows up in every trial, interrupts
+ * and hypervisor preemption of shared CI machines rarely do, so the smallest
+ * per trial maximum is checked. Single trial checks the plain maximum.
+ */
+
+#define _GNU_SOURCE /* CPU affinity */
+
+/* Standard library includes */
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* Files under test includes */
+#include "block.h"
+
+/* Macros and Constants */
+#define BENCH_MAX_THREADS (64U)
+#define BENCH_WORKING_SET (256U)
+#define BENCH_HIST_BUCKETS (40U)
+#define BENCH_DEFAULT_ROUNDS (2000000U) /* 1 << 30 calls with 4 threads */
+#define BENCH_DEFAULT_THREADS (4U)
+#define BENCH_MAX_TRIALS (100U)
+#define BENCH_RESET_ROUNDS (64U) /* Reset clears whole pool in hard real-time mode */
+
+/* Type definitions */
+typedef struct
+{
+    size_t rounds;
+    size_t cpu;
+    uint64_t maxAlloc;
+    uint64_t maxFree;
+    uint64_t calls;
+    uint64_t failed;
+    uint64_t hist[BENCH_HIST_BUCKETS];
+    bool reset; /* Reset phase, pool is reset instead of freed */
+    pthread_barrier_t * pStart;
+} bench_thread_t;
+
+/* Static variables */
+static int benchPolicy = SCHED_OTHER;
+
+/* Static functions */
+
+static inline uint64_t bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile ("isb\n\tmrs %0, cntvct_el0" : "=r" (ticks) : : "memory");
+    return ticks;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static void bench_record(bench_thread_t * pThread, uint64_t * pMax, uint64_t elapsed)
+{
+    size_t bucket = 0U;
+    while ((bucket < (BENCH_HIST_BUCKETS - 1U)) && ((elapsed >> bucket) > 1U))
+    {
+        bucket++;
+    }
+    pThread->hist[bucket]++;
+    pThread->calls++;
+    *pMax = (elapsed > *pMax) ? elapsed : *pMax;
+}
+
+static void * bench_thread(void * pArg)
+{
+    bench_thread_t * pThread = (bench_thread_t *)pArg;
+    void * pBlocks[BENCH_WORKING_SET] = { NULL };
+    cpu_set_t cpus;
+    struct sched_param param = { .sched_priority = sched_get_priority_max(SCHED_FIFO) - 1 };
+
+    CPU_ZERO(&cpus);
+    CPU_SET(pThread->cpu, &cpus);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (0 == pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+    {
+        __atomic_store_n(&benchPolicy, SCHED_FIFO, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        /* No CAP_SYS_NICE or RLIMIT_RTPRIO, measured under normal scheduling */
+    }
+    (void)pthread_barrier_wait(pThread->pStart);
+
+    for (size_t round = 0U; round < pThread->rounds; round++)
+    {
+        for (size_t slot = 0U; slot < BENCH_WORKING_SET; slot++)
+        {
+            uint64_t start = bench_cycles();
+            pBlocks[slot] = block_alloc();
+            bench_record(pThread, &pThread->maxAlloc, bench_cycles() - start);
+            pThread->failed += (NULL == pBlocks[slot]) ? 1U : 0U;
+        }
+        if (pThread->reset)
+        {
+            /* Dirty blocks left in use, next round allocates right after reset */
+            for (size_t slot = 0U; slot < BENCH_WORKING_SET; slot++)
+            {
+                if (NULL != pBlocks[slot])
+                {
+                    memset(pBlocks[slot], 0xA5, block_size());
+                }
+                else
+                {
+                    /* Failed allocation */
+                }
+            }
+            block_reset_all();
+        }
+        else
+        {
+            for (size_t slot = 0U; slot < BENCH_WORKING_SET; slot++)
+            {
+                uint64_t start = bench_cycles();
+                if (0U == (slot % 2U))
+                {
+                    block_free(pBlocks[slot]);
+                }
+                else
+                {
+                    (void)block_try_free(pBlocks[slot]);
+                }
+                bench_record(pThread, &pThread->maxFree, bench_cycles() - start);
+            }
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char ** argv)
+{
+    size_t rounds = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_ROUNDS;
+    size_t threads = (argc > 2) ? strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_THREADS;
+    uint64_t maxCycles = (argc > 3) ? strtoull(argv[3], NULL, 10) : 0U;
+    size_t trials = (argc > 4) ? strtoul(argv[4], NULL, 10) : 1U;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    static bench_thread_t benchThreads[BENCH_MAX_THREADS];
+    pthread_t ids[BENCH_MAX_THREADS];
+    pthread_barrier_t start;
+    uint64_t bestWorst = UINT64_MAX;
+    uint64_t calls = 0U;
+    uint64_t failed = 0U;
+    uint64_t hist[BENCH_HIST_BUCKETS] = { 0U };
+    int result = 0;
+
+    threads = ((threads > 0U) && (threads <= BENCH_MAX_THREADS)) ? threads : BENCH_DEFAULT_THREADS;
+    trials = ((trials > 0U) && (trials <= BENCH_MAX_TRIALS)) ? trials : 1U;
+    cpus = (cpus > 0) ? cpus : 1;
+    /* FIFO threads sharing a CPU never preempt each other, waits would be scheduling not allocator */
+    threads = (threads <= (size_t)cpus) ? threads : (size_t)cpus;
+    /* Page faults are not part of allocator worst case */
+    (void)mlockall(MCL_CURRENT | MCL_FUTURE);
+    block_init();
+
+    printf("# block size: %zu, threads: %zu, rounds: %zu, trials: %zu\n", block_size(), threads, rounds, trials);
+    printf("%8s %16s %16s %16s\n", "trial", "max alloc", "max free", "alloc at reset");
+    for (size_t trial = 0U; trial < trials; trial++)
+    {
+        uint64_t maxAlloc = 0U;
+        uint64_t maxFree = 0U;
+        uint64_t maxReset = 0U;
+        /* Churn on every thread, then reset phase on single thread, pool is idle otherwise */
+        for (size_t phase = 0U; phase < 2U; phase++)
+        {
+            bool reset = (1U == phase);
+            size_t phaseThreads = reset ? 1U : threads;
+            (void)pthread_barrier_init(&start, NULL, (unsigned)phaseThreads);
+            for (size_t thread = 0U; thread < phaseThreads; thread++)
+            {
+                memset(&benchThreads[thread], 0, sizeof(benchThreads[thread]));
+                benchThreads[thread].rounds = reset ? BENCH_RESET_ROUNDS : rounds;
+                benchThreads[thread].cpu = thread % (size_t)cpus;
+                benchThreads[thread].reset = reset;
+                benchThreads[thread].pStart = &start;
+                (void)pthread_create(&ids[thread], NULL, bench_thread, &benchThreads[thread]);
+            }
+            for (size_t thread = 0U; thread < phaseThreads; thread++)
+            {
+                uint64_t * pMaxAlloc = reset ? &maxReset : &maxAlloc;
+                (void)pthread_join(ids[thread], NULL);
+                *pMaxAlloc = (benchThreads[thread].maxAlloc > *pMaxAlloc) ? benchThreads[thread].maxAlloc : *pMaxAlloc;
+                maxFree = (benchThreads[thread].maxFree > maxFree) ? benchThreads[thread].maxFree : maxFree;
+                calls += benchThreads[thread].calls;
+                failed += benchThreads[thread].failed;
+                for (size_t bucket = 0U; bucket < BENCH_HIST_BUCKETS; bucket++)
+                {
+                    hist[bucket] += benchThreads[thread].hist[bucket];
+                }
+            }
+            (void)pthread_barrier_destroy(&start);
+        }
+        printf("%8zu %16llu %16llu %16llu\n", trial, (unsigned long long)maxAlloc, (unsigned long long)maxFree,
+               (unsigned long long)maxReset);
+        maxAlloc = (maxAlloc > maxFree) ? maxAlloc : maxFree;
+        maxAlloc = (maxAlloc > maxReset) ? maxAlloc : maxReset;
+        bestWorst = (maxAlloc < bestWorst) ? maxAlloc : bestWorst;
+    }
+
+    printf("# calls: %llu, failed allocs: %llu, policy: %s\n", (unsigned long long)calls, (unsigned long long)failed,
+           (SCHED_FIFO == benchPolicy) ? "SCHED_FIFO" : "SCHED_OTHER (not permitted)");
+    printf("# calls per cycle range\n");
+    for (size_t bucket = 0U; bucket < BENCH_HIST_BUCKETS; bucket++)
+    {
+        if (0U != hist[bucket])
+        {
+            printf("%12llu - %-12llu %llu\n", (unsigned long long)(bucket ? (1ULL << bucket) : 0U),
+                   (unsigned long long)((2ULL << bucket) - 1U), (unsigned long long)hist[bucket]);
+        }
+        else
+        {
+            /* Empty bucket */
+        }
+    }
+    if ((0U != maxCycles) && (bestWorst > maxCycles))
+    {
+        printf("FAIL: worst case of every trial above %llu cycles\n", (unsigned long long)maxCycles);
+        result = 1;
+    }
+    else
+    {
+        /* No limit or within limit */
+    }
+    return result;
+}
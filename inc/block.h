@@ -12,9 +12,81 @@
 #define BLOCK_H
 
 /* Includes */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /* Macros and Constants */
 
+#define BLOCK_WAIT_FOREVER (UINT64_MAX) /* block_alloc_wait() timeout without limit */
+#define BLOCK_HANDLE_NIL   (UINT32_MAX) /* Invalid block handle */
+
+/* Type definitions */
+
+/**
+ * @brief Allocation priority
+ */
+typedef enum
+{
+    BLOCK_PRIO_NORMAL = 0, /* Regular allocation, refused once only emergency reserve is left */
+    BLOCK_PRIO_HIGH   = 1  /* Critical allocation (error handling, control plane), may take emergency reserve */
+} block_prio_t;
+
+/**
+ * @brief Compact block reference, block index in low 24 bits and generation in high 8 bits
+ */
+typedef uint32_t block_handle_t;
+
+/**
+ * @brief Allocator statistics snapshot
+ */
+typedef struct
+{
+    size_t blocksTotal;     /* Number of blocks in pool */
+    size_t blocksUsed;      /* Number of blocks currently allocated */
+    size_t stealAttempts;   /* Home shard/sub-pool misses that looked for blocks elsewhere */
+    size_t steals;          /* Misses served by stealing from other shard/sub-pool */
+    size_t blocksStolen;    /* Blocks moved from other shards/sub-pools */
+    size_t waiters;         /* Callers parked in block_alloc_wait() */
+    size_t reserve;         /* Blocks held back for high priority allocations */
+    size_t reserveRejected; /* Normal priority allocations refused by emergency reserve */
+    size_t residentBytes;   /* Bytes of pool resident in memory */
+    size_t trimmedBytes;    /* Resident bytes returned to the OS by trimming */
+    size_t trims;           /* Trim passes */
+    size_t lockedBytes;     /* Bytes of pool and metadata locked in memory by prefault */
+} block_stats_t;
+
+/**
+ * @brief Tenant statistics snapshot
+ */
+typedef struct
+{
+    size_t used;     /* Blocks currently allocated by tenant */
+    size_t reserved; /* Blocks guaranteed to tenant */
+    size_t limit;    /* Hard cap on blocks of tenant */
+    size_t rejected; /* Allocations refused by cap or full shared capacity */
+} block_tenant_stats_t;
+
+/**
+ * @brief Policy of returning free pages of pool to the OS
+ */
+typedef struct
+{
+    uint32_t intervalMs;  /* Background trim period, 0 stops background trimming */
+    size_t minFreeBlocks; /* Background trim runs only with at least this many free blocks */
+    bool lazy;            /* MADV_FREE, kernel reclaims pages under memory pressure only */
+} block_trim_policy_t;
+
+/**
+ * @brief Allocation scope, blocks allocated in scope are released together when it ends
+ */
+typedef struct
+{
+    void * pRecord; /* Newest record block listing scope blocks, NULL when scope is empty */
+    size_t count;   /* Blocks listed in newest record */
+    size_t epoch;   /* Pool epoch records belong to, reset drops them */
+} block_scope_t;
+
 /* Public function prototypes */
 
 void block_init(void);
@@ -23,4 +95,69 @@ void * block_alloc(void);
 
 void block_free(void * pBlock);
 
+void * block_alloc_prio(block_prio_t prio);
+
+void * block_try_alloc(void);
+
+bool block_try_free(void * pBlock);
+
+block_handle_t block_alloc_h(void);
+
+bool block_free_h(block_handle_t handle);
+
+void * block_deref(block_handle_t handle);
+
+void * block_alloc_contig(size_t count);
+
+void block_free_contig(void * pBlock, size_t count);
+
+void * block_alloc_near(const void * pHint);
+
+void block_scope_begin(block_scope_t * pScope);
+
+void * block_scope_alloc(block_scope_t * pScope);
+
+void block_scope_end(block_scope_t * pScope);
+
+/* Time proportional to shards, not pool size, except sub-pool maps in work stealing mode; invalidates open scopes */
+void block_reset_all(void);
+
+bool block_ref(const void * pBlock);
+
+bool block_unref(void * pBlock);
+
+void * block_make_unique(void * pBlock);
+
+#ifdef ALLOC_PRIORITY_RESERVE
+bool block_set_reserve(size_t blocks);
+#endif
+
+#if defined(ALLOC_NUM_TENANTS) && (ALLOC_NUM_TENANTS > 0)
+bool block_tenant_config(size_t tenant, size_t reserved, size_t limit);
+
+void * block_alloc_tenant(size_t tenant);
+
+bool block_get_tenant_stats(size_t tenant, block_tenant_stats_t * pStats);
+#endif
+
+#if !defined(EMBEDDED_TARGET) && !defined(ALLOC_HARD_REALTIME)
+void * block_alloc_wait(uint64_t timeoutNs);
+
+int block_pool_fd(void);
+
+void block_set_low_watermark(size_t freeBlocks);
+
+size_t block_trim(void);
+
+bool block_set_trim_policy(const block_trim_policy_t * pPolicy);
+#endif
+
+bool block_owns(const void * pBlock);
+
+void * block_base_of(const void * pBlock);
+
+size_t block_size(void);
+
+void block_get_stats(block_stats_t * pStats);
+
 #endif // BLOCK_H
@@ -14,6 +14,9 @@
 
 #ifndef EMBEDDED_TARGET
 /* If not running on embedded target, use standard library */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* Linux specific extensions e.g. sched_getcpu */
+#endif
 #include <stdio.h>
 #include <stdatomic.h>
 #include <stdint.h>
@@ -23,16 +26,51 @@
 /* "Mutex" atomic operations */
 #define MUX_LOCK(mux)   while(atomic_exchange(mux, 1) == 1){}
 #define MUX_UNLOCK(mux) atomic_store(mux, 0)
+#define MUX_TRYLOCK(mux) (atomic_exchange(mux, 1) == 0) /* Single attempt, safe in signal handlers */
 #define ATOMIC _Atomic               
-#else 
-/* Define definitions for target e.g. mutex lock, compile time asserts*/
-#define COMPILE_TIME_ASSERT(condition) () \ // To be defined depending on target/compiler
-#define MUX_LOCK(mux) () \ // To be defined depending on target e.g. RTOS/other
-#define MUX_UNLOCK(mux) () \ // To be defined depending on target e.g. RTOS/other
-#define ATOMIC
-
-typedef unsigned char uint8_t; // Support for uint8_t if not defined
+/* Lock-free operations, used outside of mutex protected sections */
+#define ATOMIC_LOAD(obj)          atomic_load_explicit(obj, memory_order_acquire)
+#define ATOMIC_LOAD_SEQ_CST(obj)  atomic_load(obj) /* Ordered after preceding unlock/RMW, plain load on x86 */
+#define ATOMIC_STORE(obj, value)  atomic_store_explicit(obj, value, memory_order_release)
+#define ATOMIC_XCHG(obj, value)   atomic_exchange_explicit(obj, value, memory_order_acq_rel)
+#define ATOMIC_CAS(obj, pExpected, desired) \
+    atomic_compare_exchange_strong_explicit(obj, pExpected, desired, memory_order_acq_rel, memory_order_acquire)
+#define ATOMIC_FETCH_AND(obj, value) atomic_fetch_and_explicit(obj, value, memory_order_acq_rel)
+#define ATOMIC_FETCH_OR(obj, value)  atomic_fetch_or_explicit(obj, value, memory_order_acq_rel)
+/* Statistic counters, no ordering needed */
+#define ATOMIC_FETCH_ADD(obj, value) atomic_fetch_add_explicit(obj, value, memory_order_relaxed)
+#define ATOMIC_FETCH_SUB(obj, value) atomic_fetch_sub_explicit(obj, value, memory_order_relaxed)
+/* Bit operations on 32 bit words */
+#define BIT_CTZ(word)      ((size_t)__builtin_ctz(word))
+#define BIT_POPCOUNT(word) ((size_t)__builtin_popcount(word))
+#define BIT_CLZ(word)      ((size_t)__builtin_clz(word))
+/* Per thread storage and cache line alignment of shared data */
+#define THREAD_LOCAL _Thread_local
+#define CACHE_ALIGNED _Alignas(64)
+#define PAGE_ALIGNED _Alignas(4096) /* Smallest page size of hosted targets */
+/* CPU calling thread runs on, negative if unknown */
+#ifdef __linux__
+#include <sched.h>
+#define CURRENT_CPU() sched_getcpu() /* Served from rseq area by glibc 2.35+, no syscall */
+#else
+#define CURRENT_CPU() (-1)
+#endif
+#else
+/* Embedded target, locks and atomic operations come from port selected with BLOCK_PORT */
+#include "block_port.h"
+#include <stdbool.h>
+#include <stdint.h>
 
+/* Compile time assert */
+#define COMPILE_TIME_ASSERT(condition) _Static_assert(condition, "Compile-time assertion failed")
+/* Bit operations on 32 bit words */
+#define BIT_CTZ(word)      ((size_t)__builtin_ctz(word))
+#define BIT_POPCOUNT(word) ((size_t)__builtin_popcount(word))
+#define BIT_CLZ(word)      ((size_t)__builtin_clz(word))
+#define THREAD_LOCAL // Single shard expected on target without thread local storage
+#define CACHE_ALIGNED
+#define PAGE_ALIGNED
+#define CURRENT_CPU() (0) // Single core, to be defined for multi-core targets e.g. core ID register
 #endif
 
 
@@ -0,0 +1,64 @@
+/**
+ * @file block_fallback.h
+ * @author Hrvoje Z
+ * @brief Composable fallback allocator header file
+ * @version 0.1
+ * @date 2025-01-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+#ifndef BLOCK_FALLBACK_H
+#define BLOCK_FALLBACK_H
+
+/* Includes */
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Macros and Constants */
+
+/* Type definitions */
+
+/**
+ * @brief Generic block allocator interface
+ * 
+ * owns() must be a constant time check. Allocator without owns() is treated as
+ * catch-all and may only be used as last allocator in a chain.
+ */
+typedef struct block_allocator
+{
+    void * (*alloc)(void * pCtx);                      /* Allocate single block */
+    void   (*free)(void * pCtx, void * pBlock);        /* Free single block */
+    bool   (*owns)(void * pCtx, const void * pBlock);  /* Ownership check, NULL for catch-all */
+    void * pCtx;                                       /* Allocator specific context */
+} block_allocator_t;
+
+/**
+ * @brief Fallback allocator, serves from primary and overflows to secondary
+ */
+typedef struct block_fallback
+{
+    block_allocator_t primary;   /* Allocator used first */
+    block_allocator_t secondary; /* Allocator used when primary is exhausted */
+} block_fallback_t;
+
+/* Public variables */
+
+extern const block_allocator_t blockPoolAllocator; /* Static pool allocator */
+#ifndef EMBEDDED_TARGET
+extern const block_allocator_t blockHeapAllocator; /* malloc/free allocator, blocks of block_size() bytes */
+#endif
+
+/* Public function prototypes */
+
+void block_fallback_init(block_fallback_t * pFallback, const block_allocator_t * pPrimary, const block_allocator_t * pSecondary);
+
+void * block_fallback_alloc(block_fallback_t * pFallback);
+
+void block_fallback_free(block_fallback_t * pFallback, void * pBlock);
+
+bool block_fallback_owns(block_fallback_t * pFallback, const void * pBlock);
+
+block_allocator_t block_fallback_allocator(block_fallback_t * pFallback);
+
+#endif // BLOCK_FALLBACK_H
@@ -0,0 +1,168 @@
+/**
+ * @file block_port.h
+ * @author Hrvoje Z
+ * @brief Embedded port layer header file
+ * @version 0.1
+ * @date 2025-01-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * Allocator synchronization on embedded targets is built on three port hooks:
+ * interrupt mask (PORT_IRQ_SAVE/PORT_IRQ_RESTORE), atomic compare-and-swap
+ * (PORT_CAS) and critical section per lock (PORT_CRITICAL_ENTER/EXIT/TRY).
+ * Port is selected with BLOCK_PORT, every other atomic operation of the
+ * allocator is derived here from the hooks of the selected port.
+ */
+#ifndef BLOCK_PORT_H
+#define BLOCK_PORT_H
+
+/* Macros and Constants */
+
+#define BLOCK_PORT_BAREMETAL (1) /* Single core, interrupts masked in critical sections */
+#define BLOCK_PORT_RTOS      (2) /* RTOS mutex for critical sections, C11 atomics */
+#define BLOCK_PORT_C11       (3) /* C11 atomics and spin locks, no interrupt masking */
+#define BLOCK_PORT_POSIX     (4) /* Bare-metal port simulated on POSIX, signals stand in for interrupts */
+
+#ifndef BLOCK_PORT
+#define BLOCK_PORT (BLOCK_PORT_BAREMETAL) // Default port
+#endif
+
+#if (BLOCK_PORT == BLOCK_PORT_POSIX) && !defined(_GNU_SOURCE) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L /* Signal masks, before first system header */
+#endif
+
+/* Includes */
+#include <stdbool.h>
+#include <stdint.h>
+#ifdef BLOCK_PORT_CONFIG
+#include BLOCK_PORT_CONFIG /* Application hooks overriding port defaults, e.g. PORT_IRQ_SAVE() */
+#endif
+
+#if (BLOCK_PORT == BLOCK_PORT_BAREMETAL)
+#include "port/block_port_baremetal.h"
+#elif (BLOCK_PORT == BLOCK_PORT_RTOS)
+#include "port/block_port_rtos.h"
+#elif (BLOCK_PORT == BLOCK_PORT_C11)
+#include "port/block_port_c11.h"
+#elif (BLOCK_PORT == BLOCK_PORT_POSIX)
+#include "port/block_port_posix.h"
+#else
+#error "Unknown BLOCK_PORT"
+#endif
+
+#if PORT_ATOMIC_NATIVE
+/* Port provides C11 atomics, same operations as hosted build */
+#include <stdatomic.h>
+#define ATOMIC _Atomic
+#define ATOMIC_LOAD(obj)          atomic_load_explicit(obj, memory_order_acquire)
+#define ATOMIC_LOAD_SEQ_CST(obj)  atomic_load(obj)
+#define ATOMIC_STORE(obj, value)  atomic_store_explicit(obj, value, memory_order_release)
+#define ATOMIC_XCHG(obj, value)   atomic_exchange_explicit(obj, value, memory_order_acq_rel)
+#define ATOMIC_CAS(obj, pExpected, desired) PORT_CAS(obj, pExpected, desired)
+#define ATOMIC_FETCH_AND(obj, value) atomic_fetch_and_explicit(obj, value, memory_order_acq_rel)
+#define ATOMIC_FETCH_OR(obj, value)  atomic_fetch_or_explicit(obj, value, memory_order_acq_rel)
+#define ATOMIC_FETCH_ADD(obj, value) atomic_fetch_add_explicit(obj, value, memory_order_relaxed)
+#define ATOMIC_FETCH_SUB(obj, value) atomic_fetch_sub_explicit(obj, value, memory_order_relaxed)
+#else
+/*
+ * Read-modify-write operations are CAS loops on PORT_CAS. Port guarantees
+ * naturally aligned loads and stores up to pointer width are single accesses.
+ */
+#ifndef PORT_CAS
+/* Compare and swap inside atomic section of port */
+#define PORT_CAS(obj, pExpected, desired) \
+    __extension__ ({ \
+        port_irq_t atomicIrq_ = PORT_ATOMIC_ENTER(); \
+        bool swapped_ = (*(obj) == *(pExpected)); \
+        if (swapped_) { *(obj) = (desired); } else { *(pExpected) = *(obj); } \
+        PORT_ATOMIC_EXIT(atomicIrq_); \
+        swapped_; \
+    })
+#endif
+#define ATOMIC volatile
+#define ATOMIC_LOAD(obj)          __extension__ ({ __typeof__(*(obj)) value_ = *(obj); PORT_BARRIER(); value_; })
+#define ATOMIC_LOAD_SEQ_CST(obj)  ATOMIC_LOAD(obj)
+#define ATOMIC_STORE(obj, value)  do { PORT_BARRIER(); *(obj) = (value); PORT_BARRIER(); } while (0)
+#define ATOMIC_CAS(obj, pExpected, desired) PORT_CAS(obj, pExpected, desired)
+#define PORT_RMW(obj, update) \
+    __extension__ ({ \
+        __typeof__(*(obj)) old_ = *(obj); \
+        while (!PORT_CAS(obj, &old_, (__typeof__(*(obj)))(update))) {} \
+        old_; \
+    })
+#define ATOMIC_XCHG(obj, value)      PORT_RMW(obj, (value))
+#define ATOMIC_FETCH_AND(obj, value) PORT_RMW(obj, old_ & (value))
+#define ATOMIC_FETCH_OR(obj, value)  PORT_RMW(obj, old_ | (value))
+#define ATOMIC_FETCH_ADD(obj, value) PORT_RMW(obj, old_ + (value))
+#define ATOMIC_FETCH_SUB(obj, value) PORT_RMW(obj, old_ - (value))
+#endif
+
+#ifndef PORT_CRITICAL_ENTER
+#define PORT_CRITICAL_GENERIC (1) /* Locks built on interrupt mask and CAS hooks */
+
+/* Interrupt state of lock held by current core, restored on unlock */
+extern PORT_CPU_LOCAL port_irq_t portLockIrq;
+
+/**
+ * @brief Enter critical section of lock: mask interrupts, then take lock flag
+ *
+ * @param pMux Lock flag
+ */
+static inline void port_critical_enter(ATOMIC uint8_t * pMux)
+{
+    port_irq_t irq = PORT_IRQ_SAVE();
+    uint8_t expected = 0U;
+    /* Never spins on single core, holder had interrupts masked */
+    while (!PORT_CAS(pMux, &expected, 1U))
+    {
+        expected = 0U;
+    }
+    portLockIrq = irq;
+}
+
+/**
+ * @brief Leave critical section of lock
+ *
+ * @param pMux Lock flag
+ */
+static inline void port_critical_exit(ATOMIC uint8_t * pMux)
+{
+    port_irq_t irq = portLockIrq;
+    ATOMIC_STORE(pMux, 0U);
+    PORT_IRQ_RESTORE(irq);
+}
+
+/**
+ * @brief Try to enter critical section of lock once
+ *
+ * @param pMux Lock flag
+ * @return true Lock taken, interrupts masked
+ * @return false Lock held by other core
+ */
+static inline bool port_critical_try(ATOMIC uint8_t * pMux)
+{
+    port_irq_t irq = PORT_IRQ_SAVE();
+    uint8_t expected = 0U;
+    bool taken = PORT_CAS(pMux, &expected, 1U);
+    if (taken)
+    {
+        portLockIrq = irq;
+    }
+    else
+    {
+        PORT_IRQ_RESTORE(irq);
+    }
+    return taken;
+}
+
+#define PORT_CRITICAL_ENTER(mux) port_critical_enter(mux)
+#define PORT_CRITICAL_EXIT(mux)  port_critical_exit(mux)
+#define PORT_CRITICAL_TRY(mux)   port_critical_try(mux)
+#endif
+
+/* Allocator locks, shard locks are never nested */
+#define MUX_LOCK(mux)    PORT_CRITICAL_ENTER(mux)
+#define MUX_UNLOCK(mux)  PORT_CRITICAL_EXIT(mux)
+#define MUX_TRYLOCK(mux) PORT_CRITICAL_TRY(mux) /* Single attempt, safe in interrupt handlers */
+
+#endif // BLOCK_PORT_H
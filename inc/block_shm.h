@@ -0,0 +1,66 @@
+/**
+ * @file block_shm.h
+ * @author Hrvoje Z
+ * @brief Shared memory block pool header file
+ * @version 0.1
+ * @date 2025-01-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+#ifndef BLOCK_SHM_H
+#define BLOCK_SHM_H
+
+/* Includes */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Macros and Constants */
+
+#define BLOCK_SHM_NIL (UINT32_MAX) /* Invalid block index */
+
+/* Type definitions */
+
+/**
+ * @brief Process local handle of shared memory pool
+ */
+typedef struct block_shm block_shm_t;
+
+/* Public function prototypes */
+
+#ifndef EMBEDDED_TARGET
+block_shm_t * block_shm_create(const char * pName, size_t blockSize, size_t numBlocks);
+
+block_shm_t * block_shm_open(const char * pName);
+
+block_shm_t * block_shm_attach(int fd);
+
+block_shm_t * block_shm_map_file(const char * pPath, size_t blockSize, size_t numBlocks);
+
+bool block_shm_recovered(const block_shm_t * pShm);
+
+void block_shm_detach(block_shm_t * pShm);
+
+int block_shm_fd(const block_shm_t * pShm);
+
+uint32_t block_shm_alloc(block_shm_t * pShm);
+
+bool block_shm_free(block_shm_t * pShm, uint32_t index);
+
+void block_shm_mark_dirty(block_shm_t * pShm, uint32_t index);
+
+bool block_shm_checkpoint(block_shm_t * pShm, int fd, bool full);
+
+bool block_shm_restore(block_shm_t * pShm, int fd);
+
+void * block_shm_ptr(const block_shm_t * pShm, uint32_t index);
+
+uint32_t block_shm_index_of(const block_shm_t * pShm, const void * pBlock);
+
+size_t block_shm_block_size(const block_shm_t * pShm);
+
+size_t block_shm_num_blocks(const block_shm_t * pShm);
+#endif
+
+#endif // BLOCK_SHM_H
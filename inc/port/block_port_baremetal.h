@@ -0,0 +1,67 @@
+/**
+ * @file block_port_baremetal.h
+ * @author Hrvoje Z
+ * @brief Bare-metal single core port header file
+ * @version 0.1
+ * @date 2025-01-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * Critical sections and atomic operations mask interrupts, which excludes
+ * every other context on a single core. Cortex-M (PRIMASK) and RISC-V
+ * (mstatus.MIE) are supported out of the box, other cores define port_irq_t,
+ * PORT_IRQ_SAVE() and PORT_IRQ_RESTORE(state) in BLOCK_PORT_CONFIG header.
+ */
+#ifndef BLOCK_PORT_BAREMETAL_H
+#define BLOCK_PORT_BAREMETAL_H
+
+/* Includes */
+#include <stdint.h>
+
+/* Interrupt mask hooks */
+#ifndef PORT_IRQ_SAVE
+typedef uint32_t port_irq_t;
+
+#if defined(__ARM_ARCH_6M__) || defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || \
+    defined(__ARM_ARCH_8M_BASE__) || defined(__ARM_ARCH_8M_MAIN__)
+static inline port_irq_t port_irq_save(void)
+{
+    port_irq_t primask;
+    __asm__ volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) : : "memory");
+    return primask;
+}
+
+static inline void port_irq_restore(port_irq_t primask)
+{
+    __asm__ volatile ("msr primask, %0" : : "r" (primask) : "memory");
+}
+#elif defined(__riscv)
+static inline port_irq_t port_irq_save(void)
+{
+    port_irq_t mstatus;
+    __asm__ volatile ("csrrci %0, mstatus, 8" : "=r" (mstatus) : : "memory"); /* Clear MIE */
+    return mstatus;
+}
+
+static inline void port_irq_restore(port_irq_t mstatus)
+{
+    __asm__ volatile ("csrs mstatus, %0" : : "r" (mstatus & 8U) : "memory"); /* Set MIE if it was set */
+}
+#else
+#error "Define port_irq_t, PORT_IRQ_SAVE() and PORT_IRQ_RESTORE(state) for this core"
+#endif
+
+#define PORT_IRQ_SAVE()         port_irq_save()
+#define PORT_IRQ_RESTORE(state) port_irq_restore(state)
+#endif
+
+/* Atomic section hooks, masked interrupts are enough on single core */
+#define PORT_ATOMIC_NATIVE (0)
+#define PORT_ATOMIC_ENTER()       PORT_IRQ_SAVE()
+#define PORT_ATOMIC_EXIT(state)   PORT_IRQ_RESTORE(state)
+#define PORT_BARRIER()            __asm__ volatile ("" : : : "memory")
+
+/* Single core, interrupt state of held lock is global */
+#define PORT_CPU_LOCAL
+
+#endif // BLOCK_PORT_BAREMETAL_H
@@ -0,0 +1,38 @@
+/**
+ * @file block_port_c11.h
+ * @author Hrvoje Z
+ * @brief C11 atomics port header file
+ * @version 0.1
+ * @date 2025-01-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * Portable port for multi-core targets with lock-free C11 atomics. Locks are
+ * spin locks, interrupts are not masked, so interrupt handlers must use
+ * block_try_alloc()/block_try_free() only.
+ */
+#ifndef BLOCK_PORT_C11_H
+#define BLOCK_PORT_C11_H
+
+/* Includes */
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt mask hooks, not available from portable C */
+typedef uint32_t port_irq_t;
+
+#define PORT_IRQ_SAVE()         ((port_irq_t)0U)
+#define PORT_IRQ_RESTORE(state) ((void)(state))
+
+/* Atomic compare and swap hook */
+#define PORT_ATOMIC_NATIVE (1)
+#define PORT_CAS(obj, pExpected, desired) \
+    atomic_compare_exchange_strong_explicit(obj, pExpected, desired, memory_order_acq_rel, memory_order_acquire)
+
+/* Critical section hooks, spin lock on lock flag */
+#define PORT_CRITICAL_ENTER(mux) while (atomic_exchange_explicit(mux, 1U, memory_order_acquire) == 1U) {}
+#define PORT_CRITICAL_EXIT(mux)  atomic_store_explicit(mux, 0U, memory_order_release)
+#define PORT_CRITICAL_TRY(mux)   (atomic_exchange_explicit(mux, 1U, memory_order_acquire) == 0U)
+
+#endif // BLOCK_PORT_C11_H
@@ -0,0 +1,43 @@
+/**
+ * @file block_port_posix.h
+ * @author Hrvoje Z
+ * @brief POSIX simulation of bare-metal port header file
+ * @version 0.1
+ * @date 2025-01-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * Runs the bare-metal code path on POSIX hosts. Signals stand in for
+ * interrupts and are blocked where a core would mask interrupts. Threads
+ * stand in for cores, so atomic sections also take a global bus lock.
+ */
+#ifndef BLOCK_PORT_POSIX_H
+#define BLOCK_PORT_POSIX_H
+
+/* Includes */
+#include <signal.h>
+
+/* Interrupt mask hooks */
+typedef sigset_t port_irq_t;
+
+port_irq_t port_posix_irq_save(void);
+
+void port_posix_irq_restore(port_irq_t state);
+
+port_irq_t port_posix_bus_lock(void);
+
+void port_posix_bus_unlock(port_irq_t state);
+
+#define PORT_IRQ_SAVE()         port_posix_irq_save()
+#define PORT_IRQ_RESTORE(state) port_posix_irq_restore(state)
+
+/* Atomic section hooks, signals blocked and bus lock held */
+#define PORT_ATOMIC_NATIVE (0)
+#define PORT_ATOMIC_ENTER()       port_posix_bus_lock()
+#define PORT_ATOMIC_EXIT(state)   port_posix_bus_unlock(state)
+#define PORT_BARRIER()            __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/* Every thread is a core with own interrupt state */
+#define PORT_CPU_LOCAL _Thread_local
+
+#endif // BLOCK_PORT_POSIX_H
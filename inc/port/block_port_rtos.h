@@ -0,0 +1,56 @@
+/**
+ * @file block_port_rtos.h
+ * @author Hrvoje Z
+ * @brief RTOS port header file
+ * @version 0.1
+ * @date 2025-01-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * Allocator locks map to one RTOS mutex and atomics to C11 atomics. The
+ * application implements the hooks below with its RTOS, e.g. on FreeRTOS:
+ *
+ *   lock:        xSemaphoreTake(blockMutex, portMAX_DELAY)
+ *   unlock:      xSemaphoreGive(blockMutex)
+ *   trylock:     !xPortIsInsideInterrupt() && xSemaphoreTake(blockMutex, 0)
+ *   irq save:    portSET_INTERRUPT_MASK_FROM_ISR()
+ *   irq restore: portCLEAR_INTERRUPT_MASK_FROM_ISR(state)
+ *
+ * Mutexes can not be taken from interrupts, trylock must fail there and
+ * interrupt handlers use block_try_alloc()/block_try_free() only.
+ */
+#ifndef BLOCK_PORT_RTOS_H
+#define BLOCK_PORT_RTOS_H
+
+/* Includes */
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt mask hooks, implemented by application */
+typedef uint32_t port_irq_t;
+
+port_irq_t block_port_rtos_irq_save(void);
+
+void block_port_rtos_irq_restore(port_irq_t state);
+
+#define PORT_IRQ_SAVE()         block_port_rtos_irq_save()
+#define PORT_IRQ_RESTORE(state) block_port_rtos_irq_restore(state)
+
+/* Atomic compare and swap hook */
+#define PORT_ATOMIC_NATIVE (1)
+#define PORT_CAS(obj, pExpected, desired) \
+    atomic_compare_exchange_strong_explicit(obj, pExpected, desired, memory_order_acq_rel, memory_order_acquire)
+
+/* Critical section hooks, single RTOS mutex for all shards, implemented by application */
+void block_port_rtos_lock(void);
+
+void block_port_rtos_unlock(void);
+
+bool block_port_rtos_trylock(void);
+
+#define PORT_CRITICAL_ENTER(mux) do { (void)(mux); block_port_rtos_lock(); } while (0)
+#define PORT_CRITICAL_EXIT(mux)  do { (void)(mux); block_port_rtos_unlock(); } while (0)
+#define PORT_CRITICAL_TRY(mux)   ((void)(mux), block_port_rtos_trylock())
+
+#endif // BLOCK_PORT_RTOS_H
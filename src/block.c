@@ -13,6 +13,24 @@
 #include "block_defs.h"
 #include "block.h"
 
+#ifndef EMBEDDED_TARGET
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#else
+#include <fcntl.h>
+#endif
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /* Macros and Constants */
 
 
@@ -28,8 +46,145 @@
 #define BLOCK_NUMS (10U) // Default value
 #endif
 
+#ifdef ALLOC_NUM_SHARDS
+#define BLOCK_SHARDS (ALLOC_NUM_SHARDS)
+#else
+#define BLOCK_SHARDS (1U) // Default value, single lock for whole pool
+#endif
+
+#ifdef ALLOC_REMOTE_FREE
+#define BLOCK_REMOTE_FREE (1U) // Non-owner frees go to owner shard remote free stack
+#else
+#define BLOCK_REMOTE_FREE (0U)
+#endif
+
+#ifdef ALLOC_SHARD_BY_CPU
+#define BLOCK_SHARD_BY_CPU (1U) // Home shard selected by CPU thread runs on
+#else
+#define BLOCK_SHARD_BY_CPU (0U) // Home shard assigned per thread
+#endif
+
+#ifdef ALLOC_WORK_STEALING
+#define BLOCK_WORK_STEALING (1U) // Per thread sub-pools, misses steal from random victim
+#else
+#define BLOCK_WORK_STEALING (0U)
+#endif
+
+#if BLOCK_WORK_STEALING && (BLOCK_REMOTE_FREE || BLOCK_SHARD_BY_CPU)
+#error "Work stealing sub-pools are per thread and free locally, remote free and per-CPU shards do not apply"
+#endif
+
+#ifdef ALLOC_ADDRESS_ORDERED
+#define BLOCK_ADDRESS_ORDERED (1U) // Lowest free block of shard is allocated first
+#else
+#define BLOCK_ADDRESS_ORDERED (0U) // Most recently freed block is allocated first
+#endif
+
+#if BLOCK_WORK_STEALING && BLOCK_ADDRESS_ORDERED
+#error "Work stealing sub-pools hand out blocks in steal order, address ordered placement does not apply"
+#endif
+
+#ifdef ALLOC_NUM_TENANTS
+#define BLOCK_TENANTS (ALLOC_NUM_TENANTS) // Tenants with reservations and caps
+#else
+#define BLOCK_TENANTS (0U) // Default value, no tenant accounting
+#endif
+
+#define BLOCK_TENANT_DEFAULT (0U) /* Tenant of block_alloc() */
+
+#ifdef ALLOC_PRIORITY_RESERVE
+#define BLOCK_PRIORITY (1U) // Emergency reserve taken by high priority allocations only
+#else
+#define BLOCK_PRIORITY (0U)
+#endif
+
+#define BLOCK_ADMISSION ((BLOCK_TENANTS > 0U) || BLOCK_PRIORITY) /* Allocations admitted by counters */
+
+#ifdef ALLOC_HARD_REALTIME
+#define BLOCK_HARD_RT (1U) // Alloc/free work bounded, waits only on embedded ports, features with unbounded work compiled out
+#else
+#define BLOCK_HARD_RT (0U)
+#endif
+
+#if BLOCK_HARD_RT && (BLOCK_WORK_STEALING || BLOCK_REMOTE_FREE)
+#error "Hard real-time mode needs constant time free paths, steals and remote free drains scan whole pool"
+#endif
+
+#if !defined(EMBEDDED_TARGET) && !BLOCK_HARD_RT
+#define BLOCK_WAIT (1U) // Blocking allocation, needs OS for parking threads
+#else
+#define BLOCK_WAIT (0U)
+#endif
+
+#if !defined(EMBEDDED_TARGET) && !BLOCK_HARD_RT
+#define BLOCK_POOL_FD (1U) // Pool availability notification through file descriptor
+#else
+#define BLOCK_POOL_FD (0U)
+#endif
+
+#if !defined(EMBEDDED_TARGET) && !BLOCK_HARD_RT
+#define BLOCK_TRIM (1U) // Free pages returned to the OS with madvise
+#else
+#define BLOCK_TRIM (0U)
+#endif
+
+#if (defined(ALLOC_PREFAULT) || BLOCK_HARD_RT) && !defined(EMBEDDED_TARGET)
+#define BLOCK_PREFAULT (1U) // Pool and metadata faulted in and locked by init, no page faults afterwards
+#else
+#define BLOCK_PREFAULT (0U)
+#endif
+
+#if BLOCK_HARD_RT
+#define BLOCK_MERGE_BATCH (1U) /* Blocks freed by signal handlers merged per allocation */
+#else
+#define BLOCK_MERGE_BATCH ((size_t)BLOCK_NUMS) /* Next allocation merges every block freed by signal handlers */
+#endif
+
+#define BLOCK_WAIT_RECHECK_NS (10000000U) /* Waiters retry this often, blocks freed by signal handlers can not wake them */
+
+#define BLOCK_COLOR_LINE (64U)   /* Cache line, block starts are staggered by multiples of it */
+#define BLOCK_COLOR_MIN  (1024U) /* Smallest block size worth coloring, padding stays within 1/16 */
+
+#if defined(ALLOC_CACHE_COLORING) && (BLOCK_SIZE >= BLOCK_COLOR_MIN) && (0 == (BLOCK_SIZE & (BLOCK_SIZE - 1)))
+#define BLOCK_STRIDE (BLOCK_SIZE + BLOCK_COLOR_LINE) // Block starts cycle through BLOCK_SIZE / line cache colors
+#else
+#define BLOCK_STRIDE (BLOCK_SIZE) // Blocks packed back to back
+#endif
+
+#define BLOCK_PAGE_MIN (4096U) /* Smallest page size, pool is aligned to it */
+#define BLOCK_POOL_PAGES (((BLOCK_STRIDE * BLOCK_NUMS) + BLOCK_PAGE_MIN - 1U) / BLOCK_PAGE_MIN)
+#define BLOCK_NEAR_MAX (32U) /* Blocks searched on each side of locality hint at most */
+
 #define BLOCK_USED   (1U)
 #define BLOCK_UNUSED (0U)
+#define BLOCK_REMOTE (2U) /* Freed by non-owner, waiting on remote free stack */
+#define BLOCK_DEFERRED (3U) /* Freed by signal handler, waiting on deferred free list */
+#define BLOCK_FREEING (4U) /* Freed, cleared outside shard lock before it joins free list */
+#define BLOCK_STALE (5U) /* Left dirty by pool reset, cleared outside shard lock by whoever takes it */
+/* Stale used blocks re-stamped per reset, whole pool is swept before 16 bit epoch wraps */
+#define BLOCK_EPOCH_SWEEP (((size_t)BLOCK_NUMS + UINT16_MAX - 1U) / UINT16_MAX)
+#define BLOCK_REFS_MAX (UINT16_MAX) /* References besides the owner at most */
+
+#define BLOCK_NIL ((size_t)SIZE_MAX) /* Invalid block index, terminates lists */
+#define BLOCK_INDEX_NIL ((block_index_t)~(block_index_t)0U) /* Invalid block index stored in metadata */
+
+/* Handle packs block index and generation of block, generation changes on every free */
+#define BLOCK_HANDLE_INDEX_BITS (24U)
+#define BLOCK_HANDLE_INDEX_MASK ((1UL << BLOCK_HANDLE_INDEX_BITS) - 1U)
+
+/* Bits per occupancy map word and number of words covering the pool */
+#define BLOCK_MAP_BITS  (32U)
+#define BLOCK_MAP_WORDS (((size_t)BLOCK_NUMS + BLOCK_MAP_BITS - 1U) / BLOCK_MAP_BITS)
+
+/* Shards own consecutive ranges of blocks */
+#define BLOCK_SHARD_SPAN (((size_t)BLOCK_NUMS + (size_t)BLOCK_SHARDS - 1U) / (size_t)BLOCK_SHARDS)
+
+/* Free block tree of shard, each level summarizes words of level below, up to 32^4 blocks per shard */
+#define BLOCK_TREE_LEVELS (4U)
+#define BLOCK_TREE_L0 ((BLOCK_SHARD_SPAN + BLOCK_MAP_BITS - 1U) / BLOCK_MAP_BITS)
+#define BLOCK_TREE_L1 ((BLOCK_TREE_L0 + BLOCK_MAP_BITS - 1U) / BLOCK_MAP_BITS)
+#define BLOCK_TREE_L2 ((BLOCK_TREE_L1 + BLOCK_MAP_BITS - 1U) / BLOCK_MAP_BITS)
+#define BLOCK_TREE_WORDS (1U + BLOCK_TREE_L2 + BLOCK_TREE_L1 + BLOCK_TREE_L0)
 
 /* Custom Macros */
 
@@ -42,26 +197,253 @@
         }
 
 /**
- * @brief Check if pointer is aligned to block size
+ * @brief Check if pointer is aligned to block start
  */
 #define IS_PTR_ALIGNED(ptr, pool) \
-    (((uint8_t *)ptr - pool) % BLOCK_SIZE == 0U)
+    (((uint8_t *)ptr - pool) % BLOCK_STRIDE == 0U)
+
+/**
+ * @brief Check if pointer points inside the pool (constant time range check)
+ */
+#define IS_PTR_IN_POOL(ptr, pool) \
+    (((uintptr_t)(ptr) >= (uintptr_t)(pool)) && \
+     ((uintptr_t)(ptr) < ((uintptr_t)(pool) + sizeof(pool))))
 
 /**
  * @brief Convert pointer to pool index
  */
 #define BLOCK_PTR_2_INDEX(ptr, pool) \
-    (((uint8_t *)ptr - pool) / BLOCK_SIZE)
+    (((uint8_t *)ptr - pool) / BLOCK_STRIDE)
+
+/**
+ * @brief Convert pool index to shard owning the block
+ */
+#define BLOCK_INDEX_2_SHARD(index) \
+    ((index) / BLOCK_SHARD_SPAN)
 
 /* Type definitions */
 
+/**
+ * @brief Smallest type holding every block index and nil, used for links and per shard counters
+ */
+#if (BLOCK_NUMS < 0xFFU)
+typedef uint8_t block_index_t;
+#elif (BLOCK_NUMS < 0xFFFFU)
+typedef uint16_t block_index_t;
+#else
+typedef uint32_t block_index_t;
+#endif
+
+/* Scope record is a block of indices, first one links previous record */
+#define BLOCK_SCOPE_SLOTS ((BLOCK_SIZE / sizeof(block_index_t)) - 1U)
+
+#if BLOCK_WORK_STEALING
+/**
+ * @brief Per thread sub-pool, blocks move between sub-pools through lock-free steals
+ */
+typedef struct
+{
+    CACHE_ALIGNED ATOMIC uint32_t freeMap[BLOCK_MAP_WORDS]; /* Free blocks owned by sub-pool */
+    ATOMIC size_t numUsed; /* Allocations minus frees done through sub-pool, may wrap, only sum is meaningful */
+} block_shard_t;
+#else
+/**
+ * @brief Pool shard, owns a range of blocks protected by its own mutex
+ */
+typedef struct
+{
+    CACHE_ALIGNED ATOMIC uint8_t mux; /* Shard mutex */
+#if BLOCK_ADDRESS_ORDERED
+    uint32_t tree[BLOCK_TREE_WORDS];  /* Free block bitmap and summary levels, top level first */
+    block_index_t first;              /* First block of shard */
+#else
+    block_index_t freeHead;           /* Head of LIFO free list */
+#endif
+    block_index_t bump;               /* First block not allocated since init or reset */
+    block_index_t end;                /* One past last block of shard */
+    block_index_t numUsed;            /* Number of blocks used */
+#if BLOCK_REMOTE_FREE
+    ATOMIC block_index_t remoteHead;  /* MPSC stack of blocks freed by non-owners */
+#endif
+} block_shard_t;
+#endif
+
+#if (BLOCK_TENANTS > 0U)
+/**
+ * @brief Tenant accounting, counters are updated lock-free
+ */
+typedef struct
+{
+    CACHE_ALIGNED ATOMIC size_t used; /* Blocks allocated by tenant */
+    size_t reserved;                  /* Blocks guaranteed to tenant */
+    size_t limit;                     /* Hard cap on blocks of tenant */
+    ATOMIC size_t rejected;           /* Allocations refused by cap or full shared capacity */
+} block_tenant_t;
+#endif
+
+#if BLOCK_WAIT
+/**
+ * @brief Caller parked in block_alloc_wait(), lives on its stack
+ */
+typedef struct block_waiter
+{
+    struct block_waiter * pNext; /* Next waiter in FIFO order */
+    pthread_cond_t cond;         /* Signaled when block was freed for this waiter */
+    bool signaled;               /* Wake-up pending, consumed by waiter */
+} block_waiter_t;
+#endif
+
 /* Static variables */
-static uint8_t staticPool[BLOCK_SIZE * BLOCK_NUMS]; /* Static memory pool */
-static uint8_t blockUsed[BLOCK_NUMS];               /* Block used flag per block */
-static size_t blockNumUsed     = 0U;                /* Number of blocks used */
-static ATOMIC uint8_t blockMux = 0U;                /* Block mutex */
+static PAGE_ALIGNED uint8_t staticPool[BLOCK_STRIDE * BLOCK_NUMS]; /* Static memory pool, whole pages can be trimmed */
+static ATOMIC uint8_t blockUsed[BLOCK_NUMS];        /* Block state per block */
+static ATOMIC uint8_t blockGen[BLOCK_NUMS];         /* Generation per block, stale handles mismatch */
+static ATOMIC uint16_t blockStamp[BLOCK_NUMS];      /* Pool epoch block was allocated in, low bits */
+static size_t blockEpoch;                           /* Pool epoch, blocks used before last reset are stale */
+static size_t blockSweep;                           /* Next block re-stamped by reset */
+static ATOMIC uint16_t blockRefs[BLOCK_NUMS];       /* References besides the owner, last block_unref() frees */
+#if !BLOCK_WORK_STEALING
+static block_index_t blockNext[BLOCK_NUMS];         /* Free list link per block */
+#if !BLOCK_ADDRESS_ORDERED
+static block_index_t blockPrev[BLOCK_NUMS];         /* Free list back link, blocks taken by address unlink in O(1) */
+#endif
+#endif
+static block_shard_t blockShards[BLOCK_SHARDS];     /* Pool shards */
+#if BLOCK_ADDRESS_ORDERED
+/* Offset of each tree level in shard tree, level 0 is block bitmap */
+static const size_t blockTreeOffset[BLOCK_TREE_LEVELS] = {
+    1U + BLOCK_TREE_L2 + BLOCK_TREE_L1, 1U + BLOCK_TREE_L2, 1U, 0U
+};
+#endif
+#if (BLOCK_SHARDS > 1U)
+static ATOMIC size_t blockShardSeq = 0U;            /* Round robin home shard assignment */
+static THREAD_LOCAL size_t blockHomeShard = BLOCK_NIL; /* Home shard of calling thread */
+#endif
+#if BLOCK_WORK_STEALING
+static THREAD_LOCAL uint32_t blockStealSeed = 0U;   /* Victim selection random state */
+#else
+static ATOMIC block_index_t blockDeferredHead = BLOCK_INDEX_NIL; /* Blocks freed by signal handlers */
+static ATOMIC block_index_t blockMergeHead = BLOCK_INDEX_NIL;    /* Detached deferred blocks not merged yet */
+static ATOMIC uint8_t blockMergeMux = 0U;                        /* Serializes merges of deferred blocks */
+#endif
+#if (BLOCK_TENANTS > 0U)
+static block_tenant_t blockTenants[BLOCK_TENANTS];  /* Tenant accounting */
+static uint8_t blockTenantOf[BLOCK_NUMS];           /* Tenant of each allocated block */
+static CACHE_ALIGNED ATOMIC size_t blockSharedUsed = 0U; /* Blocks used above tenant reservations */
+static size_t blockSharedCap = (size_t)BLOCK_NUMS;  /* Blocks not reserved by any tenant */
+#endif
+#if BLOCK_PRIORITY
+static CACHE_ALIGNED ATOMIC size_t blockPrioUsed = 0U; /* Blocks admitted by priority check */
+static ATOMIC size_t blockReserve = 0U;             /* Blocks held back for high priority */
+static ATOMIC size_t blockReserveRejected = 0U;     /* Normal priority allocations refused */
+#endif
+#if BLOCK_WAIT
+static pthread_mutex_t blockWaitMux = PTHREAD_MUTEX_INITIALIZER; /* Protects waiter queue */
+static block_waiter_t * pWaitHead = NULL;           /* Oldest waiter */
+static block_waiter_t * pWaitTail = NULL;           /* Newest waiter */
+static ATOMIC size_t blockWaiters = 0U;             /* Number of queued waiters, checked by free */
+#endif
+#if BLOCK_POOL_FD
+static pthread_mutex_t blockFdMux = PTHREAD_MUTEX_INITIALIZER; /* Serializes descriptor creation */
+static ATOMIC int blockPoolFd = -1;                 /* Readable end of notification eventfd/pipe */
+static int blockPoolFdWrite = -1;                   /* Writable end, same as readable for eventfd */
+static ATOMIC uint8_t blockFdArmed = 0U;            /* Pool got exhausted, notify on recovery */
+static ATOMIC size_t blockLowWatermark = 0U;        /* Notify when free blocks rise above */
+static ATOMIC size_t blockFreeBlocks = 0U;          /* Free blocks, those on remote and deferred lists included */
+#endif
+#if BLOCK_TRIM
+static pthread_mutex_t blockTrimMux = PTHREAD_MUTEX_INITIALIZER; /* Serializes trim passes and policy */
+static pthread_cond_t blockTrimCond;                /* Wakes background trim thread on policy change */
+static pthread_t blockTrimThread;                   /* Background trim thread */
+static bool blockTrimRunning = false;               /* Background trim thread started */
+static block_trim_policy_t blockTrimPolicy = { .intervalMs = 0U, .minFreeBlocks = 0U, .lazy = false };
+static uint8_t blockPageVec[BLOCK_POOL_PAGES];      /* Residency of pool pages */
+static size_t blockTrimmedBytes = 0U;               /* Resident bytes returned to the OS */
+static size_t blockTrims = 0U;                      /* Trim passes */
+#if !BLOCK_WORK_STEALING && !BLOCK_PREFAULT
+static ATOMIC size_t blockTrimHeld = 0U;            /* Free blocks taken off shards while their pages are trimmed */
+#endif
+#endif
+#if BLOCK_PREFAULT
+static size_t blockLockedBytes = 0U;                /* Bytes of pool and metadata locked in memory */
+#endif
+/* Statistics, updated on slow path only */
+static ATOMIC size_t blockStealAttempts = 0U;
+static ATOMIC size_t blockSteals        = 0U;
+static ATOMIC size_t blockStolen        = 0U;
 
 /* Static function prototypes */
+static size_t shard_home(void);
+static size_t block_acquire(block_prio_t prio);
+static size_t block_take(void);
+static size_t block_try_take(void);
+static bool block_put(size_t index);
+static bool block_release(size_t index);
+static bool block_claim(size_t index, uint8_t state);
+static bool block_retire(size_t index, uint8_t gen);
+static size_t block_count_used(void);
+static void block_reset_pool(void);
+static void shard_reset(size_t shard);
+static bool block_live(size_t index);
+static void block_notify_free(void);
+static void block_notify_exhausted(void);
+#if (BLOCK_TENANTS > 0U)
+static bool tenant_admit(block_tenant_t * pTenant);
+static void tenant_release(block_tenant_t * pTenant);
+static void * tenant_alloc(size_t tenant, block_prio_t prio);
+#endif
+#if BLOCK_PRIORITY
+static bool prio_admit(block_prio_t prio);
+#endif
+#if BLOCK_WAIT
+static void block_wake(void);
+static void wait_add_ns(struct timespec * pTime, uint64_t ns);
+#endif
+#if BLOCK_POOL_FD
+static void block_fd_check(void);
+#endif
+#if BLOCK_PREFAULT
+static void block_prefault(void);
+static size_t block_lock_range(const void * pStart, size_t size);
+#endif
+#if BLOCK_TRIM
+static size_t block_resident(void);
+static void * trim_thread(void * pArg);
+#if !BLOCK_WORK_STEALING && !BLOCK_PREFAULT
+static bool trim_range_free(size_t first, size_t end);
+static bool trim_take(size_t first, size_t end);
+static void trim_return(size_t first, size_t end);
+#endif
+#endif
+#if !BLOCK_WORK_STEALING
+static bool trim_busy(void);
+#endif
+#if BLOCK_WORK_STEALING
+static size_t subpool_alloc(block_shard_t * pShard, size_t home);
+static size_t subpool_take(block_shard_t * pShard);
+static size_t subpool_steal(block_shard_t * pShard, size_t home);
+static bool subpool_free(block_shard_t * pShard, size_t index);
+#else
+static size_t shard_neighbour(size_t home, size_t offset);
+static size_t shard_alloc(block_shard_t * pShard);
+static size_t shard_take(block_shard_t * pShard);
+static void block_merge_deferred(size_t limit);
+static bool shard_free(block_shard_t * pShard, size_t index);
+static size_t shard_pop(block_shard_t * pShard);
+static void shard_push(block_shard_t * pShard, size_t index);
+static void block_reclaim(block_shard_t * pShard, size_t index);
+static void block_ready(size_t first, size_t count);
+static void shard_unlink(block_shard_t * pShard, size_t index);
+static size_t shard_take_run(size_t shard, size_t first, size_t end, size_t count);
+static uint32_t run_free_mask(size_t index, size_t end);
+static size_t run_find(size_t first, size_t end, size_t bump, size_t count);
+static bool run_admit(size_t count);
+static void run_release(size_t count);
+static void scope_push(size_t index, size_t * pLocked);
+#endif
+#if BLOCK_REMOTE_FREE
+static bool shard_free_remote(block_shard_t * pShard, size_t index);
+static size_t shard_drain_remote(block_shard_t * pShard);
+#endif
 
 /* Public functions */
 
@@ -75,12 +457,57 @@ void block_init(void)
     COMPILE_TIME_ASSERT((BLOCK_SIZE % 4U) == 0U); /* 4 byte alignment */
     COMPILE_TIME_ASSERT((BLOCK_SIZE > 0U));
     COMPILE_TIME_ASSERT((BLOCK_NUMS > 0U));
-    /* Initialize blocks to default value */
-    BLOCK_MEMSET(staticPool, sizeof(staticPool), 0U);
-    BLOCK_MEMSET(blockUsed, sizeof(blockUsed), BLOCK_UNUSED);
-    blockNumUsed = 0U;
+    COMPILE_TIME_ASSERT((BLOCK_SHARDS > 0U));
+    COMPILE_TIME_ASSERT((BLOCK_TENANTS <= 256U)); /* Tenant of block kept in uint8_t */
+    COMPILE_TIME_ASSERT((BLOCK_NUMS < BLOCK_HANDLE_INDEX_MASK)); /* Index fits handle, all ones is nil */
+#if BLOCK_ADDRESS_ORDERED
+    COMPILE_TIME_ASSERT((BLOCK_TREE_L2 <= BLOCK_MAP_BITS)); /* Tree top level is single word */
+#endif
+    block_reset_pool();
+#if !BLOCK_WORK_STEALING
     /* Initialize mutex/locks */
-    blockMux = 0U;
+    for (size_t shard = 0U; shard < (size_t)BLOCK_SHARDS; shard++)
+    {
+        blockShards[shard].mux = 0U;
+    }
+#endif
+#if (BLOCK_TENANTS > 0U)
+    /* Every tenant may use whole pool without guarantees until configured */
+    for (size_t tenant = 0U; tenant < (size_t)BLOCK_TENANTS; tenant++)
+    {
+        ATOMIC_STORE(&blockTenants[tenant].used, 0U);
+        ATOMIC_STORE(&blockTenants[tenant].rejected, 0U);
+        blockTenants[tenant].reserved = 0U;
+        blockTenants[tenant].limit = (size_t)BLOCK_NUMS;
+    }
+    ATOMIC_STORE(&blockSharedUsed, 0U);
+    blockSharedCap = (size_t)BLOCK_NUMS;
+#endif
+#if BLOCK_PRIORITY
+    /* No blocks held back until reserve is set */
+    ATOMIC_STORE(&blockPrioUsed, 0U);
+    ATOMIC_STORE(&blockReserve, 0U);
+    ATOMIC_STORE(&blockReserveRejected, 0U);
+#endif
+#if BLOCK_POOL_FD
+    ATOMIC_STORE(&blockFdArmed, 0U);
+#endif
+#if BLOCK_PREFAULT
+    /* Metadata touched and everything locked now, not on first use */
+    block_prefault();
+#endif
+#if BLOCK_TRIM
+    pthread_mutex_lock(&blockTrimMux);
+    blockTrimmedBytes = 0U;
+    blockTrims = 0U;
+    pthread_mutex_unlock(&blockTrimMux);
+#endif
+#if !BLOCK_WORK_STEALING
+    ATOMIC_STORE(&blockMergeMux, 0U);
+#endif
+    ATOMIC_STORE(&blockStealAttempts, 0U);
+    ATOMIC_STORE(&blockSteals, 0U);
+    ATOMIC_STORE(&blockStolen, 0U);
 }
 
 /**
@@ -89,76 +516,3204 @@ void block_init(void)
  * @return void* Pointer to allocated block
  */
 void * block_alloc(void)
+{
+    return block_alloc_prio(BLOCK_PRIO_NORMAL);
+}
+
+/**
+ * @brief Free single block
+ * 
+ * @param pBlock Pointer to block
+ */
+void block_free(void * pBlock)
+{
+    /* NULL Check, pool ownership and pointer alignment verification */
+    if((NULL != pBlock) && (IS_PTR_IN_POOL(pBlock, staticPool)) && (IS_PTR_ALIGNED(pBlock, staticPool)))
+    {
+        size_t index = BLOCK_PTR_2_INDEX(pBlock, staticPool);
+        /* Invalidate handles before block can be reallocated, double and stale frees keep generation */
+        if (block_retire(index, ATOMIC_LOAD(&blockGen[index])))
+        {
+            (void)block_release(index);
+        }
+        else
+        {
+            /* Double free */
+        }
+    }
+    else
+    {
+        /* Do nothing */
+    }
+}
+
+/**
+ * @brief Allocate single block and return compact handle to it
+ * 
+ * @return block_handle_t Handle of allocated block, BLOCK_HANDLE_NIL if no block is available
+ */
+block_handle_t block_alloc_h(void)
+{
+    block_handle_t handle = BLOCK_HANDLE_NIL;
+    uint8_t * pBlock = block_alloc();
+    if (NULL != pBlock)
+    {
+        size_t index = BLOCK_PTR_2_INDEX(pBlock, staticPool);
+        handle = ((block_handle_t)ATOMIC_LOAD(&blockGen[index]) << BLOCK_HANDLE_INDEX_BITS) | (block_handle_t)index;
+    }
+    else
+    {
+        /* No memory available */
+    }
+    return handle;
+}
+
+/**
+ * @brief Free block referenced by handle
+ * 
+ * Generation of handle is advanced with a CAS only while block is in use,
+ * so of concurrent frees of the same handle only one succeeds, and handles
+ * dropped by pool reset or matching a free block after generation wrap fail.
+ * 
+ * @param handle Block handle
+ * @return true Block was freed
+ * @return false Handle is stale or invalid
+ */
+bool block_free_h(block_handle_t handle)
+{
+    bool freed = false;
+    size_t index = (size_t)(handle & BLOCK_HANDLE_INDEX_MASK);
+    if (index < (size_t)BLOCK_NUMS)
+    {
+        freed = block_retire(index, (uint8_t)(handle >> BLOCK_HANDLE_INDEX_BITS)) && block_release(index);
+    }
+    else
+    {
+        /* Invalid handle */
+    }
+    return freed;
+}
+
+/**
+ * @brief Convert handle to block pointer in constant time
+ * 
+ * Generation is 8 bits wide, a handle kept across 256 reuses of its block
+ * is not detected as stale.
+ * 
+ * @param handle Block handle
+ * @return void* Pointer to block, NULL if handle is stale or invalid
+ */
+void * block_deref(block_handle_t handle)
 {
     uint8_t * pAddr = NULL;
-    /* Lock allocator */
-    MUX_LOCK(&blockMux);
-    /* Check if there are free blocks - parse through data only if memory available */
-    if ((size_t)BLOCK_NUMS > blockNumUsed) /* Data race issue possible if this variable is not protected with mutex*/
+    size_t index = (size_t)(handle & BLOCK_HANDLE_INDEX_MASK);
+    if ((index < (size_t)BLOCK_NUMS) &&
+        ((uint8_t)(handle >> BLOCK_HANDLE_INDEX_BITS) == ATOMIC_LOAD(&blockGen[index])) &&
+        block_live(index))
     {
-        /* Static pool available */
+        pAddr = &staticPool[index * BLOCK_STRIDE];
+    }
+    else
+    {
+        /* Stale or invalid handle */
+    }
+    return pAddr;
+}
 
-        /* Linear search - becomes inneficient as the pool grows */
-        /* Find first free block */
-        for(size_t index = 0U; index < (size_t)BLOCK_NUMS; index++)
+/**
+ * @brief Allocate single block without blocking, async-signal-safe
+ * 
+ * Shard locks are tried once instead of waited for, so a signal handler
+ * interrupting a thread holding a shard lock gets a block from another shard
+ * or NULL instead of deadlocking. Waiters and pool descriptor are not touched.
+ * 
+ * @return void* Pointer to allocated block, NULL if pool is exhausted or every shard is busy
+ */
+void * block_try_alloc(void)
+{
+    uint8_t * pAddr = NULL;
+    size_t index = BLOCK_NIL;
+#if (BLOCK_TENANTS > 0U)
+    if (tenant_admit(&blockTenants[BLOCK_TENANT_DEFAULT]))
+#endif
+    {
+#if BLOCK_PRIORITY
+        if (prio_admit(BLOCK_PRIO_NORMAL))
+#endif
         {
-            if (BLOCK_UNUSED == blockUsed[index])
+            index = block_try_take();
+#if BLOCK_PRIORITY
+            if (BLOCK_NIL == index)
             {
-                /* Block found */
-                blockUsed[index] = BLOCK_USED;
-                pAddr = (uint8_t *)&staticPool[index * BLOCK_SIZE];
-                blockNumUsed++;
-                break;
+                (void)ATOMIC_FETCH_SUB(&blockPrioUsed, 1U);
             }
             else
             {
-                /* No free blocks */
+                /* Do nothing */
             }
+#endif
+        }
+#if (BLOCK_TENANTS > 0U)
+        if (BLOCK_NIL != index)
+        {
+            blockTenantOf[index] = (uint8_t)BLOCK_TENANT_DEFAULT;
+        }
+        else
+        {
+            tenant_release(&blockTenants[BLOCK_TENANT_DEFAULT]);
         }
+#endif
+    }
+    if (BLOCK_NIL != index)
+    {
+        pAddr = &staticPool[index * BLOCK_STRIDE];
     }
     else
     {
-        /* No memory available */
+        /* No memory available or shards busy */
     }
-
-    /* Unlock block allocator */
-    MUX_UNLOCK(&blockMux);
-
     return pAddr;
 }
 
 /**
- * @brief Free single block
+ * @brief Free single block without blocking, async-signal-safe
+ * 
+ * Block is pushed onto a lock-free deferred list and returned to its shard
+ * by the next regular allocation. Sub-pools are lock-free and free directly.
  * 
  * @param pBlock Pointer to block
+ * @return true Block was freed
+ * @return false Pointer is not a block in use
  */
-void block_free(void * pBlock)
+bool block_try_free(void * pBlock)
 {
-    /* Lock block allocator */
-    MUX_LOCK(&blockMux);
-    /* NULL Check and pointer alignment verification */
-    if((NULL != pBlock) && (IS_PTR_ALIGNED(pBlock, staticPool)))
+    bool freed = false;
+    if((NULL != pBlock) && (IS_PTR_IN_POOL(pBlock, staticPool)) && (IS_PTR_ALIGNED(pBlock, staticPool)))
     {
-        /* Verify double free before proceeding */
         size_t index = BLOCK_PTR_2_INDEX(pBlock, staticPool);
-        if (BLOCK_USED == blockUsed[index])
+#if BLOCK_WORK_STEALING
+#if (BLOCK_TENANTS > 0U)
+        size_t tenant = blockTenantOf[index];
+#endif
+        freed = block_retire(index, ATOMIC_LOAD(&blockGen[index])) && subpool_free(&blockShards[shard_home()], index);
+        if (freed)
         {
-            /* Free block */
-            BLOCK_MEMSET(pBlock, BLOCK_SIZE, 0U);
-            blockUsed[index] = BLOCK_UNUSED;
-            blockNumUsed--; // Underflow not possible
+#if (BLOCK_TENANTS > 0U)
+            tenant_release(&blockTenants[tenant]);
+#endif
+#if BLOCK_PRIORITY
+            (void)ATOMIC_FETCH_SUB(&blockPrioUsed, 1U);
+#endif
         }
         else
         {
-            /* Do nothing */
+            /* Double free */
+        }
+#else
+        /* Counters are released by merge, block stays unavailable until then */
+        freed = block_retire(index, ATOMIC_LOAD(&blockGen[index])) && block_claim(index, BLOCK_DEFERRED);
+        if (freed)
+        {
+            block_index_t head = ATOMIC_LOAD(&blockDeferredHead);
+            do
+            {
+                blockNext[index] = head;
+            } while (!ATOMIC_CAS(&blockDeferredHead, &head, (block_index_t)index));
+#if BLOCK_POOL_FD
+            (void)ATOMIC_FETCH_ADD(&blockFreeBlocks, 1U);
+#endif
+        }
+        else
+        {
+            /* Double free */
+        }
+#endif
+#if BLOCK_POOL_FD
+        /* Counter and descriptor write are async-signal-safe, waiters retry on their own */
+        if (freed && (0U != ATOMIC_LOAD_SEQ_CST(&blockFdArmed)))
+        {
+            block_fd_check();
+        }
+        else
+        {
+            /* Nothing freed or not exhausted since last notification */
         }
+#endif
     }
     else
     {
-        /* Do nothing */
+        /* Not a block of pool */
     }
-    /* Unlock block allocator */
-    MUX_UNLOCK(&blockMux);
+    return freed;
 }
 
-/* Static functions */
+/**
+ * @brief Allocate run of adjacent blocks
+ * 
+ * Run never spans shards. Blocks are accounted to default tenant with normal
+ * priority, as the same number of block_alloc() calls would be.
+ * 
+ * @param count Number of blocks, at most number of blocks per shard
+ * @return void* Pointer to first block, count * block_size() bytes are usable,
+ *         NULL if no run is free, count is invalid or in work stealing mode
+ */
+void * block_alloc_contig(size_t count)
+{
+    uint8_t * pAddr = NULL;
+#if !BLOCK_WORK_STEALING
+    if ((0U < count) && (count <= BLOCK_SHARD_SPAN))
+    {
+        block_merge_deferred(BLOCK_MERGE_BATCH);
+        if (run_admit(count))
+        {
+            size_t index = BLOCK_NIL;
+            size_t home = shard_home();
+            /* Home shard first, then nearest neighbours */
+            do
+            {
+                for (size_t offset = 0U; (offset < (size_t)BLOCK_SHARDS) && (BLOCK_NIL == index); offset++)
+                {
+                    size_t shard = shard_neighbour(home, offset);
+                    MUX_LOCK(&blockShards[shard].mux);
+                    index = shard_take_run(shard, 0U, (size_t)BLOCK_NUMS, count);
+                    MUX_UNLOCK(&blockShards[shard].mux);
+                }
+            } while ((BLOCK_NIL == index) && trim_busy()); /* Run may cross blocks held by trim pass */
+            if (BLOCK_NIL != index)
+            {
+                block_ready(index, count);
+#if (BLOCK_TENANTS > 0U)
+                for (size_t block = index; block < (index + count); block++)
+                {
+                    blockTenantOf[block] = (uint8_t)BLOCK_TENANT_DEFAULT;
+                }
+#endif
+                pAddr = &staticPool[index * BLOCK_STRIDE];
+            }
+            else
+            {
+                /* Pool too fragmented or exhausted */
+                run_release(count);
+                block_notify_exhausted();
+            }
+        }
+        else
+        {
+            /* Refused by tenant cap or priority reserve */
+        }
+    }
+    else
+    {
+        /* Invalid run length */
+    }
+#else
+    (void)count;
+#endif
+    return pAddr;
+}
+
+/**
+ * @brief Free run of adjacent blocks allocated by block_alloc_contig()
+ * 
+ * Blocks are returned one by one, each of them is free for single block
+ * allocations right after.
+ * 
+ * @param pBlock Pointer to first block
+ * @param count Number of blocks passed to block_alloc_contig()
+ */
+void block_free_contig(void * pBlock, size_t count)
+{
+    /* NULL Check, pool ownership and pointer alignment verification */
+    if ((NULL != pBlock) && (IS_PTR_IN_POOL(pBlock, staticPool)) && (IS_PTR_ALIGNED(pBlock, staticPool)) &&
+        (count <= ((size_t)BLOCK_NUMS - BLOCK_PTR_2_INDEX(pBlock, staticPool))))
+    {
+        uint8_t * pAddr = (uint8_t *)pBlock;
+        for (size_t block = 0U; block < count; block++)
+        {
+#if (BLOCK_STRIDE != BLOCK_SIZE)
+            if ((block + 1U) < count)
+            {
+                /* Run was written across color padding, single block free clears block only */
+                BLOCK_MEMSET(&pAddr[(block * BLOCK_STRIDE) + BLOCK_SIZE], BLOCK_STRIDE - BLOCK_SIZE, 0U);
+            }
+            else
+            {
+                /* Padding after last block is never written */
+            }
+#endif
+            block_free(&pAddr[block * BLOCK_STRIDE]);
+        }
+    }
+    else
+    {
+        /* Do nothing */
+    }
+}
+
+/**
+ * @brief Allocate block close to another block of the pool
+ * 
+ * Free block sharing the page of the hinted block (or its direct neighbours
+ * when blocks span pages) is preferred, nearest at or after the hint first,
+ * so data used together stays in the same cache lines, page and TLB entry.
+ * Search is bounded to BLOCK_NEAR_MAX blocks on each side and the shard of
+ * the hint. When nothing nearby is free, or hint is not a pool block,
+ * behaves as block_alloc(). Work stealing mode always behaves as block_alloc().
+ * 
+ * @param pHint Block the new block should be close to, may be NULL
+ * @return void* Pointer to the allocated block, NULL if no blocks available
+ */
+void * block_alloc_near(const void * pHint)
+{
+    uint8_t * pAddr = NULL;
+#if !BLOCK_WORK_STEALING
+    bool refused = false;
+    if ((NULL != pHint) && (IS_PTR_IN_POOL(pHint, staticPool)) && (IS_PTR_ALIGNED(pHint, staticPool)))
+    {
+        size_t hint = BLOCK_PTR_2_INDEX(pHint, staticPool);
+        size_t shard = hint / BLOCK_SHARD_SPAN;
+        size_t page = (hint * BLOCK_STRIDE) / BLOCK_PAGE_MIN;
+        /* Blocks overlapping page of hint */
+        size_t first = (page * BLOCK_PAGE_MIN) / BLOCK_STRIDE;
+        size_t end = (((page + 1U) * BLOCK_PAGE_MIN) + BLOCK_STRIDE - 1U) / BLOCK_STRIDE;
+        if ((end - first) < 3U)
+        {
+            /* Blocks span pages, direct neighbours instead */
+            first = (hint > 0U) ? (hint - 1U) : hint;
+            end = hint + 2U;
+        }
+        else
+        {
+            /* Several blocks per page */
+        }
+        /* Bounded search */
+        first = ((hint - first) <= BLOCK_NEAR_MAX) ? first : (hint - BLOCK_NEAR_MAX);
+        end = ((end - hint) <= (BLOCK_NEAR_MAX + 1U)) ? end : (hint + BLOCK_NEAR_MAX + 1U);
+        end = (end < (size_t)BLOCK_NUMS) ? end : (size_t)BLOCK_NUMS;
+
+        block_merge_deferred(BLOCK_MERGE_BATCH);
+        if (run_admit(1U))
+        {
+            size_t index = BLOCK_NIL;
+            MUX_LOCK(&blockShards[shard].mux);
+            index = shard_take_run(shard, hint, end, 1U);
+            if (BLOCK_NIL == index)
+            {
+                /* Nothing free after hint, look before it */
+                index = shard_take_run(shard, first, hint, 1U);
+            }
+            else
+            {
+                /* Found at or after hint */
+            }
+            MUX_UNLOCK(&blockShards[shard].mux);
+            if (BLOCK_NIL != index)
+            {
+                block_ready(index, 1U);
+#if (BLOCK_TENANTS > 0U)
+                blockTenantOf[index] = (uint8_t)BLOCK_TENANT_DEFAULT;
+#endif
+                pAddr = &staticPool[index * BLOCK_STRIDE];
+            }
+            else
+            {
+                /* Neighbourhood full, any block will do */
+                run_release(1U);
+            }
+        }
+        else
+        {
+            /* Refused by tenant cap or priority reserve, block_alloc() would be refused too */
+            refused = true;
+        }
+    }
+    else
+    {
+        /* No usable hint */
+    }
+    if ((NULL == pAddr) && !refused)
+    {
+        pAddr = block_alloc();
+    }
+    else
+    {
+        /* Allocated near hint */
+    }
+#else
+    (void)pHint;
+    pAddr = block_alloc();
+#endif
+    return pAddr;
+}
+
+/**
+ * @brief Begin allocation scope, e.g. per request
+ * 
+ * Scopes are independent, a scope begun while another one is open is a mark
+ * that can be rolled back on its own. Scope is used by one thread at a time.
+ * Pool reset frees scope blocks and records, scope is empty afterwards.
+ * 
+ * @param pScope Scope to begin
+ */
+void block_scope_begin(block_scope_t * pScope)
+{
+    if (NULL != pScope)
+    {
+        pScope->pRecord = NULL;
+        pScope->count = 0U;
+        pScope->epoch = blockEpoch;
+    }
+    else
+    {
+        /* Do nothing */
+    }
+}
+
+/**
+ * @brief Allocate block owned by scope
+ * 
+ * Block index is listed in the newest record of the scope, a pool block
+ * linking previous record, so scope needs no memory besides the pool. Scope
+ * blocks are freed by block_scope_end() only, never by block_free().
+ * 
+ * @param pScope Open scope
+ * @return void* Pointer to the allocated block, NULL if no blocks available
+ */
+void * block_scope_alloc(block_scope_t * pScope)
+{
+    uint8_t * pAddr = NULL;
+    if ((NULL != pScope) && (BLOCK_SCOPE_SLOTS > 0U))
+    {
+        if (blockEpoch != pScope->epoch)
+        {
+            /* Records freed by reset may be in use by others now */
+            pScope->pRecord = NULL;
+            pScope->count = 0U;
+            pScope->epoch = blockEpoch;
+        }
+        else
+        {
+            /* Records still owned by scope */
+        }
+        if ((NULL == pScope->pRecord) || (pScope->count >= BLOCK_SCOPE_SLOTS))
+        {
+            /* Newest record full, chain new one */
+            block_index_t * pRecord = block_alloc();
+            if (NULL != pRecord)
+            {
+                pRecord[0] = (NULL == pScope->pRecord) ? BLOCK_INDEX_NIL :
+                             (block_index_t)BLOCK_PTR_2_INDEX(pScope->pRecord, staticPool);
+                pScope->pRecord = pRecord;
+                pScope->count = 0U;
+            }
+            else
+            {
+                /* Pool exhausted */
+            }
+        }
+        else
+        {
+            /* Room in newest record */
+        }
+        if ((NULL != pScope->pRecord) && (pScope->count < BLOCK_SCOPE_SLOTS))
+        {
+            pAddr = block_alloc();
+            if (NULL != pAddr)
+            {
+                block_index_t * pRecord = (block_index_t *)pScope->pRecord;
+                pRecord[1U + pScope->count] = (block_index_t)BLOCK_PTR_2_INDEX(pAddr, staticPool);
+                pScope->count++;
+            }
+            else
+            {
+                /* Pool exhausted, empty record is released with the scope */
+            }
+        }
+        else
+        {
+            /* No record */
+        }
+    }
+    else
+    {
+        /* No scope or block too small for record */
+    }
+    return pAddr;
+}
+
+/**
+ * @brief End scope, every block allocated in it and its records return to the pool
+ * 
+ * Blocks are claimed and cleared outside locks first, then pushed to their
+ * shards in one pass holding each shard lock once while consecutive blocks
+ * belong to it, which is once for blocks allocated by one thread. Records are
+ * cleared under lock, one per many blocks. Records of scope begun before a pool
+ * reset are not read, reset freed them. Scope is empty afterwards.
+ * 
+ * @param pScope Scope to end
+ */
+void block_scope_end(block_scope_t * pScope)
+{
+    if ((NULL != pScope) && (NULL != pScope->pRecord) && (blockEpoch == pScope->epoch))
+    {
+        size_t count = pScope->count;
+#if BLOCK_WORK_STEALING
+        /* Sub-pools have no locks to batch */
+        for (block_index_t * pRecord = pScope->pRecord; NULL != pRecord; count = BLOCK_SCOPE_SLOTS)
+        {
+            block_index_t prev = pRecord[0];
+            for (size_t slot = 1U; slot <= count; slot++)
+            {
+                block_free(&staticPool[(size_t)pRecord[slot] * BLOCK_STRIDE]);
+            }
+            block_free(pRecord);
+            pRecord = (BLOCK_INDEX_NIL != prev) ? (block_index_t *)&staticPool[(size_t)prev * BLOCK_STRIDE] : NULL;
+        }
+#else
+        size_t locked = BLOCK_NIL;
+        size_t freed = 0U;
+        /* Claim and clear blocks, record entry of block freed elsewhere becomes nil */
+        for (block_index_t * pRecord = pScope->pRecord; NULL != pRecord; count = BLOCK_SCOPE_SLOTS)
+        {
+            for (size_t slot = 1U; slot <= count; slot++)
+            {
+                size_t index = pRecord[slot];
+                if (block_retire(index, ATOMIC_LOAD(&blockGen[index])) && block_claim(index, BLOCK_FREEING))
+                {
+                    uint8_t * pAddr = &staticPool[index * BLOCK_STRIDE];
+                    BLOCK_MEMSET(pAddr, BLOCK_SIZE, 0U);
+                }
+                else
+                {
+                    pRecord[slot] = BLOCK_INDEX_NIL;
+                }
+            }
+            pRecord = (BLOCK_INDEX_NIL != pRecord[0]) ? (block_index_t *)&staticPool[(size_t)pRecord[0] * BLOCK_STRIDE] : NULL;
+        }
+        /* Push blocks, then record itself once read */
+        count = pScope->count;
+        for (block_index_t * pRecord = pScope->pRecord; NULL != pRecord; count = BLOCK_SCOPE_SLOTS)
+        {
+            size_t record = BLOCK_PTR_2_INDEX(pRecord, staticPool);
+            block_index_t prev = pRecord[0];
+            for (size_t slot = 1U; slot <= count; slot++)
+            {
+                if (BLOCK_INDEX_NIL != pRecord[slot])
+                {
+                    scope_push(pRecord[slot], &locked);
+                    freed++;
+                }
+                else
+                {
+                    /* Freed elsewhere */
+                }
+            }
+            if (block_retire(record, ATOMIC_LOAD(&blockGen[record])) && block_claim(record, BLOCK_FREEING))
+            {
+                BLOCK_MEMSET(pRecord, BLOCK_SIZE, 0U);
+                scope_push(record, &locked);
+                freed++;
+            }
+            else
+            {
+                /* Record freed elsewhere */
+            }
+            pRecord = (BLOCK_INDEX_NIL != prev) ? (block_index_t *)&staticPool[(size_t)prev * BLOCK_STRIDE] : NULL;
+        }
+        if (BLOCK_NIL != locked)
+        {
+            MUX_UNLOCK(&blockShards[locked].mux);
+        }
+        else
+        {
+            /* Nothing pushed */
+        }
+#if BLOCK_PRIORITY
+        (void)ATOMIC_FETCH_SUB(&blockPrioUsed, freed);
+#endif
+        for (size_t block = 0U; block < freed; block++)
+        {
+            block_notify_free();
+        }
+#endif
+        pScope->pRecord = NULL;
+        pScope->count = 0U;
+    }
+    else if (NULL != pScope)
+    {
+        /* Nothing allocated in scope, or reset freed its blocks */
+        pScope->pRecord = NULL;
+        pScope->count = 0U;
+    }
+    else
+    {
+        /* No scope */
+    }
+}
+
+/**
+ * @brief Free every block of the pool at once, e.g. between batch jobs
+ * 
+ * Pool epoch is bumped, blocks stamped with an earlier epoch no longer count
+ * as used so stale pointers, handles and scopes are refused, and every shard
+ * starts over from its first block. Blocks are not touched: the ones left in
+ * use are cleared by whoever takes them next, outside shard locks. Reset takes
+ * time proportional to number of shards plus BLOCK_EPOCH_SWEEP stale blocks
+ * re-stamped so none matches again when the 16 bit stamp wraps. Sub-pools of
+ * work stealing mode refill their maps, a word per 32 blocks each. Tenant and
+ * reserve configuration is kept. Must not run concurrently with any other
+ * allocator call.
+ */
+void block_reset_all(void)
+{
+    blockEpoch++;
+    for (size_t block = 0U; block < BLOCK_EPOCH_SWEEP; block++)
+    {
+        if (BLOCK_USED == ATOMIC_LOAD(&blockUsed[blockSweep]))
+        {
+            /* Stale, kept an epoch behind until bump index or sub-pool takes it */
+            ATOMIC_STORE(&blockStamp[blockSweep], (uint16_t)(blockEpoch - 1U));
+        }
+        else
+        {
+            /* Free or not stamped */
+        }
+        blockSweep = (blockSweep + 1U) % (size_t)BLOCK_NUMS;
+    }
+    for (size_t shard = 0U; shard < (size_t)BLOCK_SHARDS; shard++)
+    {
+        shard_reset(shard);
+    }
+#if !BLOCK_WORK_STEALING
+    ATOMIC_STORE(&blockDeferredHead, BLOCK_INDEX_NIL);
+    ATOMIC_STORE(&blockMergeHead, BLOCK_INDEX_NIL);
+#endif
+#if BLOCK_POOL_FD
+    ATOMIC_STORE(&blockFreeBlocks, (size_t)BLOCK_NUMS);
+#endif
+#if (BLOCK_TENANTS > 0U)
+    for (size_t tenant = 0U; tenant < (size_t)BLOCK_TENANTS; tenant++)
+    {
+        ATOMIC_STORE(&blockTenants[tenant].used, 0U);
+    }
+    ATOMIC_STORE(&blockSharedUsed, 0U);
+#endif
+#if BLOCK_PRIORITY
+    ATOMIC_STORE(&blockPrioUsed, 0U);
+#endif
+}
+
+/**
+ * @brief Take another reference to block, e.g. for each consumer of shared payload
+ * 
+ * References are counted in a side array, block contents are not touched.
+ * Block returns to the pool when every reference, the allocating one included,
+ * is dropped with block_unref().
+ * 
+ * @param pBlock Allocated block
+ * @return true Reference taken
+ * @return false Not an allocated block or reference count saturated
+ */
+bool block_ref(const void * pBlock)
+{
+    bool taken = false;
+    if ((NULL != pBlock) && (IS_PTR_IN_POOL(pBlock, staticPool)) && (IS_PTR_ALIGNED(pBlock, staticPool)))
+    {
+        size_t index = BLOCK_PTR_2_INDEX(pBlock, staticPool);
+        uint16_t refs = ATOMIC_LOAD(&blockRefs[index]);
+        while (block_live(index) && (refs < BLOCK_REFS_MAX) && !taken)
+        {
+            taken = ATOMIC_CAS(&blockRefs[index], &refs, (uint16_t)(refs + 1U));
+        }
+    }
+    else
+    {
+        /* Not a block of pool */
+    }
+    return taken;
+}
+
+/**
+ * @brief Drop reference to block, last reference frees it
+ * 
+ * @param pBlock Referenced block
+ * @return true Last reference dropped, block returned to the pool
+ * @return false Other references remain, or not an allocated block
+ */
+bool block_unref(void * pBlock)
+{
+    bool last = false;
+    if ((NULL != pBlock) && (IS_PTR_IN_POOL(pBlock, staticPool)) && (IS_PTR_ALIGNED(pBlock, staticPool)))
+    {
+        size_t index = BLOCK_PTR_2_INDEX(pBlock, staticPool);
+        uint16_t refs = ATOMIC_LOAD(&blockRefs[index]);
+        bool dropped = false;
+        while ((0U != refs) && !dropped)
+        {
+            dropped = ATOMIC_CAS(&blockRefs[index], &refs, (uint16_t)(refs - 1U));
+        }
+        if (!dropped && block_live(index))
+        {
+            /* Sole owner */
+            block_free(pBlock);
+            last = true;
+        }
+        else
+        {
+            /* Shared with other holders, or already free */
+        }
+    }
+    else
+    {
+        /* Not a block of pool */
+    }
+    return last;
+}
+
+/**
+ * @brief Get block the caller may modify, copy on write of shared block
+ * 
+ * Sole owner gets the block back. Shared block is copied to a new block and
+ * reference of caller to the shared one is dropped, other holders keep seeing
+ * the original contents.
+ * 
+ * @param pBlock Referenced block
+ * @return void* Block owned by caller only, NULL if copy could not be allocated (reference is kept)
+ */
+void * block_make_unique(void * pBlock)
+{
+    uint8_t * pUnique = NULL;
+    if ((NULL != pBlock) && (IS_PTR_IN_POOL(pBlock, staticPool)) && (IS_PTR_ALIGNED(pBlock, staticPool)) &&
+        block_live(BLOCK_PTR_2_INDEX(pBlock, staticPool)))
+    {
+        size_t index = BLOCK_PTR_2_INDEX(pBlock, staticPool);
+        if (0U == ATOMIC_LOAD(&blockRefs[index]))
+        {
+            /* No other holders, references are only taken by holders */
+            pUnique = (uint8_t *)pBlock;
+        }
+        else
+        {
+            pUnique = block_alloc();
+            if (NULL != pUnique)
+            {
+                const uint8_t * pShared = (const uint8_t *)pBlock;
+                for (size_t byte = 0U; byte < BLOCK_SIZE; byte++)
+                {
+                    pUnique[byte] = pShared[byte];
+                }
+                (void)block_unref(pBlock);
+            }
+            else
+            {
+                /* Pool exhausted */
+            }
+        }
+    }
+    else
+    {
+        /* Not an allocated block of pool */
+    }
+    return pUnique;
+}
+
+/**
+ * @brief Allocate single block with given priority
+ * 
+ * Normal priority is refused once only the emergency reserve is left, high
+ * priority may use whole pool.
+ * 
+ * @param prio Allocation priority
+ * @return void* Pointer to allocated block, NULL if no block is available for priority
+ */
+void * block_alloc_prio(block_prio_t prio)
+{
+    uint8_t * pAddr = NULL;
+#if !BLOCK_WORK_STEALING
+    /* Blocks freed by signal handlers release their admission counters before admission */
+    block_merge_deferred(BLOCK_MERGE_BATCH);
+#endif
+#if (BLOCK_TENANTS > 0U)
+    /* Untagged allocations are accounted to default tenant */
+    pAddr = tenant_alloc(BLOCK_TENANT_DEFAULT, prio);
+#else
+    size_t index = block_acquire(prio);
+    if (BLOCK_NIL != index)
+    {
+        pAddr = &staticPool[index * BLOCK_STRIDE];
+    }
+    else
+    {
+        /* No memory available */
+    }
+#endif
+    return pAddr;
+}
+
+#if BLOCK_PRIORITY
+/**
+ * @brief Set number of blocks held back for high priority allocations
+ * 
+ * Blocks already in use are not affected, a reserve larger than currently free
+ * blocks only refuses normal priority allocations until enough blocks are freed.
+ * 
+ * @param blocks Blocks normal priority allocations must leave free
+ * @return true Reserve applied
+ * @return false Reserve larger than pool
+ */
+bool block_set_reserve(size_t blocks)
+{
+    bool valid = (blocks <= (size_t)BLOCK_NUMS);
+    if (valid)
+    {
+        ATOMIC_STORE(&blockReserve, blocks);
+    }
+    else
+    {
+        /* Invalid reserve */
+    }
+    return valid;
+}
+#endif
+
+#if (BLOCK_TENANTS > 0U)
+/**
+ * @brief Configure tenant reservation and cap, to be called before tenant allocates
+ * 
+ * @param tenant Tenant ID
+ * @param reserved Blocks guaranteed to tenant regardless of other tenants
+ * @param limit Maximum number of blocks tenant may hold
+ * @return true Configuration applied
+ * @return false Invalid tenant, reserved above limit or reservations exceed pool
+ */
+bool block_tenant_config(size_t tenant, size_t reserved, size_t limit)
+{
+    bool valid = (tenant < (size_t)BLOCK_TENANTS) && (reserved <= limit) && (limit <= (size_t)BLOCK_NUMS);
+    if (valid)
+    {
+        size_t reservedTotal = reserved;
+        for (size_t other = 0U; other < (size_t)BLOCK_TENANTS; other++)
+        {
+            reservedTotal += (other != tenant) ? blockTenants[other].reserved : 0U;
+        }
+        valid = (reservedTotal <= (size_t)BLOCK_NUMS);
+        if (valid)
+        {
+            blockTenants[tenant].reserved = reserved;
+            blockTenants[tenant].limit = limit;
+            blockSharedCap = (size_t)BLOCK_NUMS - reservedTotal;
+        }
+        else
+        {
+            /* Reservations would exceed pool */
+        }
+    }
+    else
+    {
+        /* Invalid configuration */
+    }
+    return valid;
+}
+
+/**
+ * @brief Allocate single block on behalf of tenant
+ * 
+ * Blocks within tenant reservation are always available, blocks above it come
+ * from capacity shared by all tenants, up to tenant limit.
+ * 
+ * @param tenant Tenant ID
+ * @return void* Pointer to allocated block, NULL if tenant cap or pool is exhausted
+ */
+void * block_alloc_tenant(size_t tenant)
+{
+#if !BLOCK_WORK_STEALING
+    block_merge_deferred(BLOCK_MERGE_BATCH);
+#endif
+    return tenant_alloc(tenant, BLOCK_PRIO_NORMAL);
+}
+
+/**
+ * @brief Get usage statistics of tenant
+ * 
+ * @param tenant Tenant ID
+ * @param pStats Statistics output
+ * @return true Statistics filled
+ * @return false Invalid tenant or output
+ */
+bool block_get_tenant_stats(size_t tenant, block_tenant_stats_t * pStats)
+{
+    bool valid = (tenant < (size_t)BLOCK_TENANTS) && (NULL != pStats);
+    if (valid)
+    {
+        pStats->used     = ATOMIC_LOAD(&blockTenants[tenant].used);
+        pStats->reserved = blockTenants[tenant].reserved;
+        pStats->limit    = blockTenants[tenant].limit;
+        pStats->rejected = ATOMIC_LOAD(&blockTenants[tenant].rejected);
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return valid;
+}
+#endif
+
+#if BLOCK_WAIT
+/**
+ * @brief Allocate single block, wait for a free block if pool is exhausted
+ * 
+ * Waiters are parked in FIFO order and woken one per freed block. Blocks
+ * freed by block_try_free() can not wake them, waiters notice those within
+ * BLOCK_WAIT_RECHECK_NS.
+ * 
+ * @param timeoutNs Maximum time to wait in nanoseconds, 0 does not wait, BLOCK_WAIT_FOREVER has no limit
+ * @return void* Pointer to allocated block, NULL on timeout
+ */
+void * block_alloc_wait(uint64_t timeoutNs)
+{
+    void * pAddr = block_alloc();
+    if ((NULL == pAddr) && (0U != timeoutNs))
+    {
+        block_waiter_t waiter = { .pNext = NULL, .signaled = false };
+        pthread_condattr_t attr;
+        struct timespec deadline;
+        bool timedOut = false;
+
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&waiter.cond, &attr);
+        pthread_condattr_destroy(&attr);
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        wait_add_ns(&deadline, timeoutNs);
+
+        pthread_mutex_lock(&blockWaitMux);
+        /* Enqueue at tail */
+        if (NULL == pWaitTail)
+        {
+            pWaitHead = &waiter;
+        }
+        else
+        {
+            pWaitTail->pNext = &waiter;
+        }
+        pWaitTail = &waiter;
+        (void)atomic_fetch_add(&blockWaiters, 1U); /* Ordered before retry, pairs with check in free */
+        pthread_mutex_unlock(&blockWaitMux);
+
+        /* Retry after registering so a free in between is never missed, queue is never locked
+         * around allocation as merging deferred frees and arming pool descriptor wake waiters */
+        pAddr = block_alloc();
+        pthread_mutex_lock(&blockWaitMux);
+        while ((NULL == pAddr) && !timedOut)
+        {
+            struct timespec now;
+            if (!waiter.signaled)
+            {
+                /* Sleep in bounded slices, block freed by signal handler is merged by retry only */
+                struct timespec slice;
+                clock_gettime(CLOCK_MONOTONIC, &slice);
+                wait_add_ns(&slice, BLOCK_WAIT_RECHECK_NS);
+                if ((slice.tv_sec > deadline.tv_sec) || ((slice.tv_sec == deadline.tv_sec) && (slice.tv_nsec > deadline.tv_nsec)))
+                {
+                    slice = deadline;
+                }
+                else
+                {
+                    /* Deadline further than next retry */
+                }
+                (void)pthread_cond_timedwait(&waiter.cond, &blockWaitMux, &slice);
+            }
+            else
+            {
+                /* Woken before we got to wait */
+            }
+            /* Wake-up consumed by retry, block may still be taken by a caller not waiting */
+            waiter.signaled = false;
+            pthread_mutex_unlock(&blockWaitMux);
+            pAddr = block_alloc();
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            timedOut = (now.tv_sec > deadline.tv_sec) || ((now.tv_sec == deadline.tv_sec) && (now.tv_nsec >= deadline.tv_nsec));
+            pthread_mutex_lock(&blockWaitMux);
+        }
+
+        /* Dequeue, waiter may be anywhere in queue after timeout */
+        block_waiter_t * pPrev = NULL;
+        block_waiter_t * pIter = pWaitHead;
+        while (&waiter != pIter)
+        {
+            pPrev = pIter;
+            pIter = pIter->pNext;
+        }
+        if (NULL == pPrev)
+        {
+            pWaitHead = waiter.pNext;
+        }
+        else
+        {
+            pPrev->pNext = waiter.pNext;
+        }
+        if (&waiter == pWaitTail)
+        {
+            pWaitTail = pPrev;
+        }
+        else
+        {
+            /* Not last */
+        }
+        (void)ATOMIC_FETCH_SUB(&blockWaiters, 1U);
+        pthread_mutex_unlock(&blockWaitMux);
+        pthread_cond_destroy(&waiter.cond);
+    }
+    else
+    {
+        /* Served without waiting */
+    }
+    return pAddr;
+}
+#endif
+
+/**
+ * @brief Check if pointer belongs to static pool
+ * 
+ * @param pBlock Pointer to check, may point anywhere inside a block
+ * @return true Pointer lies within static pool
+ * @return false Pointer is NULL or belongs to other memory
+ */
+bool block_owns(const void * pBlock)
+{
+    /* Pool bounds are fixed, no lock needed */
+    return (IS_PTR_IN_POOL(pBlock, staticPool));
+}
+
+/**
+ * @brief Map pointer inside a block to start of that block
+ * 
+ * @param pBlock Pointer to any byte of a block
+ * @return void* Pointer to start of block, NULL if pointer is not owned by pool
+ */
+void * block_base_of(const void * pBlock)
+{
+    uint8_t * pAddr = NULL;
+    if (IS_PTR_IN_POOL(pBlock, staticPool))
+    {
+        pAddr = &staticPool[BLOCK_PTR_2_INDEX(pBlock, staticPool) * BLOCK_STRIDE];
+    }
+    else
+    {
+        /* Not owned by pool */
+    }
+    return pAddr;
+}
+
+/**
+ * @brief Get size of single block
+ * 
+ * @return size_t Block size in bytes
+ */
+size_t block_size(void)
+{
+    return (size_t)BLOCK_SIZE;
+}
+
+/**
+ * @brief Get allocator statistics snapshot
+ * 
+ * @param pStats Statistics output
+ */
+void block_get_stats(block_stats_t * pStats)
+{
+    if (NULL != pStats)
+    {
+        pStats->blocksTotal   = (size_t)BLOCK_NUMS;
+        pStats->blocksUsed    = block_count_used();
+        pStats->stealAttempts = ATOMIC_LOAD(&blockStealAttempts);
+        pStats->steals        = ATOMIC_LOAD(&blockSteals);
+        pStats->blocksStolen  = ATOMIC_LOAD(&blockStolen);
+#if BLOCK_WAIT
+        pStats->waiters       = ATOMIC_LOAD(&blockWaiters);
+#else
+        pStats->waiters       = 0U;
+#endif
+#if BLOCK_PRIORITY
+        pStats->reserve         = ATOMIC_LOAD(&blockReserve);
+        pStats->reserveRejected = ATOMIC_LOAD(&blockReserveRejected);
+#else
+        pStats->reserve         = 0U;
+        pStats->reserveRejected = 0U;
+#endif
+#if BLOCK_TRIM
+        pthread_mutex_lock(&blockTrimMux);
+        pStats->residentBytes   = block_resident();
+        pStats->trimmedBytes    = blockTrimmedBytes;
+        pStats->trims           = blockTrims;
+        pthread_mutex_unlock(&blockTrimMux);
+#else
+        pStats->residentBytes   = sizeof(staticPool);
+        pStats->trimmedBytes    = 0U;
+        pStats->trims           = 0U;
+#endif
+#if BLOCK_PREFAULT
+        pStats->lockedBytes     = blockLockedBytes;
+#else
+        pStats->lockedBytes     = 0U;
+#endif
+    }
+    else
+    {
+        /* Do nothing */
+    }
+}
+
+#if BLOCK_POOL_FD
+/**
+ * @brief Get file descriptor signaling pool availability, created on first call
+ * 
+ * Descriptor becomes readable once free blocks rise above the low watermark after the
+ * pool got exhausted. Reading it (8 bytes for eventfd) re-enables the notification.
+ * 
+ * @return int File descriptor for poll/epoll, -1 if it could not be created
+ */
+int block_pool_fd(void)
+{
+    int fd = ATOMIC_LOAD(&blockPoolFd);
+    if (0 > fd)
+    {
+        pthread_mutex_lock(&blockFdMux);
+        fd = ATOMIC_LOAD(&blockPoolFd);
+        if (0 > fd)
+        {
+            int fds[2] = { -1, -1 };
+#ifdef __linux__
+            fds[0] = eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC);
+            fds[1] = fds[0];
+#else
+            if (0 == pipe(fds))
+            {
+                (void)fcntl(fds[0], F_SETFL, O_NONBLOCK);
+                (void)fcntl(fds[1], F_SETFL, O_NONBLOCK);
+            }
+            else
+            {
+                /* Creation failed */
+            }
+#endif
+            if (0 <= fds[0])
+            {
+                /* Write end is set before descriptor is published */
+                blockPoolFdWrite = fds[1];
+                ATOMIC_STORE(&blockPoolFd, fds[0]);
+            }
+            else
+            {
+                /* Creation failed */
+            }
+            fd = fds[0];
+        }
+        else
+        {
+            /* Created by other thread meanwhile */
+        }
+        pthread_mutex_unlock(&blockFdMux);
+    }
+    else
+    {
+        /* Already created */
+    }
+    return fd;
+}
+
+/**
+ * @brief Set low watermark for pool availability notification
+ * 
+ * @param freeBlocks Descriptor becomes readable when more than this many blocks are free
+ */
+void block_set_low_watermark(size_t freeBlocks)
+{
+    ATOMIC_STORE(&blockLowWatermark, freeBlocks);
+}
+#endif
+
+#if BLOCK_TRIM
+/**
+ * @brief Return resident pages of pool covered only by free blocks to the OS
+ * 
+ * Free blocks of a run of candidate pages are taken off their shards one page
+ * at a time, so no block of a trimmed page can be allocated meanwhile, and
+ * returned after the pages are advised. No shard lock is held across system
+ * calls. Free blocks are zero already and read as zero after trimming too,
+ * kernel hands back zero filled pages. Work stealing sub-pools
+ * are lock-free and are not trimmed, prefaulted pool is locked and is not trimmed.
+ * 
+ * @return size_t Number of resident bytes returned
+ */
+size_t block_trim(void)
+{
+    size_t released = 0U;
+    pthread_mutex_lock(&blockTrimMux);
+#if !BLOCK_WORK_STEALING && !BLOCK_PREFAULT
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = sizeof(staticPool) / pageSize; /* Whole pages only */
+    int advice = MADV_DONTNEED;
+#ifdef MADV_FREE
+    advice = blockTrimPolicy.lazy ? MADV_FREE : MADV_DONTNEED;
+#endif
+    if ((0U < pages) && (0 == mincore(staticPool, pages * pageSize, blockPageVec)))
+    {
+        size_t runStart = 0U;
+        size_t runPages = 0U;
+        size_t heldFirst = 0U; /* Blocks taken for current run */
+        size_t heldEnd = 0U;
+        for (size_t page = 0U; page <= pages; page++)
+        {
+            size_t first = (page * pageSize) / BLOCK_STRIDE;
+            size_t end = ((((page + 1U) * pageSize) - 1U) / BLOCK_STRIDE) + 1U;
+            bool taken = false;
+            end = (end < (size_t)BLOCK_NUMS) ? end : (size_t)BLOCK_NUMS;
+            /* Block shared with previous page of run is held already */
+            first = ((0U < runPages) && (first < heldEnd)) ? heldEnd : first;
+            /* Only resident pages are advised, they are the ones costing memory */
+            if ((page < pages) && (0U != (blockPageVec[page] & 1U)) && trim_range_free(first, end))
+            {
+                taken = trim_take(first, end);
+            }
+            else
+            {
+                /* Page not resident or holds used block */
+            }
+            if (taken)
+            {
+                runStart = (0U == runPages) ? page : runStart;
+                heldFirst = (0U == runPages) ? first : heldFirst;
+                heldEnd = (end > first) ? end : heldEnd;
+                runPages++;
+            }
+            else if (0U < runPages)
+            {
+                /* Run of free pages ended, advise it with single call and hand its blocks back */
+                uint8_t * pRun = &staticPool[runStart * pageSize];
+                if ((0 == madvise(pRun, runPages * pageSize, advice)) ||
+                    (0 == madvise(pRun, runPages * pageSize, MADV_DONTNEED)))
+                {
+                    released += runPages * pageSize;
+                }
+                else
+                {
+                    /* Advice refused, pages stay resident */
+                }
+                trim_return(heldFirst, heldEnd);
+                runPages = 0U;
+            }
+            else
+            {
+                /* Do nothing */
+            }
+        }
+    }
+    else
+    {
+        /* Pool smaller than page or residency unknown */
+    }
+#endif
+    blockTrimmedBytes += released;
+    blockTrims++;
+    pthread_mutex_unlock(&blockTrimMux);
+    return released;
+}
+
+/**
+ * @brief Set trim advice and background trimming policy
+ * 
+ * Background thread is started when interval becomes non-zero and stopped when
+ * it is set back to zero.
+ * 
+ * @param pPolicy Trim policy
+ * @return true Policy applied
+ * @return false Invalid policy or background thread could not be started
+ */
+bool block_set_trim_policy(const block_trim_policy_t * pPolicy)
+{
+    bool applied = (NULL != pPolicy);
+    bool join = false;
+    if (applied)
+    {
+        pthread_mutex_lock(&blockTrimMux);
+        blockTrimPolicy = *pPolicy;
+        if ((0U != pPolicy->intervalMs) && !blockTrimRunning)
+        {
+            pthread_condattr_t attr;
+            pthread_condattr_init(&attr);
+            pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+            pthread_cond_init(&blockTrimCond, &attr);
+            pthread_condattr_destroy(&attr);
+            blockTrimRunning = (0 == pthread_create(&blockTrimThread, NULL, trim_thread, NULL));
+            applied = blockTrimRunning;
+            if (!applied)
+            {
+                blockTrimPolicy.intervalMs = 0U;
+                pthread_cond_destroy(&blockTrimCond);
+            }
+            else
+            {
+                /* Do nothing */
+            }
+        }
+        else if ((0U == pPolicy->intervalMs) && blockTrimRunning)
+        {
+            /* Thread sees zero interval and exits */
+            pthread_cond_signal(&blockTrimCond);
+            blockTrimRunning = false;
+            join = true;
+        }
+        else
+        {
+            /* Running thread picks up new policy */
+            pthread_cond_signal(&blockTrimCond);
+        }
+        pthread_mutex_unlock(&blockTrimMux);
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    if (join)
+    {
+        pthread_join(blockTrimThread, NULL);
+        pthread_cond_destroy(&blockTrimCond);
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return applied;
+}
+#endif
+
+/* Static functions */
+
+/**
+ * @brief Get home shard of calling thread
+ * 
+ * Shard of current CPU in per-CPU mode, otherwise assigned round robin on first use.
+ * 
+ * @return size_t Shard index
+ */
+static size_t shard_home(void)
+{
+    size_t home = 0U;
+#if (BLOCK_SHARDS > 1U)
+    int cpu = -1;
+#if BLOCK_SHARD_BY_CPU
+    cpu = CURRENT_CPU();
+#endif
+    if (0 <= cpu)
+    {
+        /* Thread may migrate right after, shard mutex keeps this safe */
+        home = (size_t)cpu % (size_t)BLOCK_SHARDS;
+    }
+    else
+    {
+        if (BLOCK_NIL == blockHomeShard)
+        {
+            blockHomeShard = ATOMIC_FETCH_ADD(&blockShardSeq, 1U) % (size_t)BLOCK_SHARDS;
+        }
+        else
+        {
+            /* Already assigned */
+        }
+        home = blockHomeShard;
+    }
+#endif
+    return home;
+}
+
+#if !BLOCK_WORK_STEALING
+/**
+ * @brief Get shard at given search offset from home, alternating between both sides
+ * 
+ * Offsets 0, 1, 2, 3, 4 map to home, home + 1, home - 1, home + 2, home - 2 (modulo shard count).
+ * 
+ * @param home Home shard
+ * @param offset Search offset
+ * @return size_t Shard index
+ */
+static size_t shard_neighbour(size_t home, size_t offset)
+{
+    size_t distance = (offset + 1U) / 2U;
+    size_t shard;
+    if (0U != (offset % 2U))
+    {
+        shard = (home + distance) % (size_t)BLOCK_SHARDS;
+    }
+    else
+    {
+        shard = (home + (size_t)BLOCK_SHARDS - (distance % (size_t)BLOCK_SHARDS)) % (size_t)BLOCK_SHARDS;
+    }
+    return shard;
+}
+
+/**
+ * @brief Allocate single block from shard
+ * 
+ * @param pShard Shard to allocate from
+ * @return size_t Block index, BLOCK_NIL if shard is exhausted
+ */
+static size_t shard_alloc(block_shard_t * pShard)
+{
+    /* Lock shard */
+    MUX_LOCK(&pShard->mux);
+    size_t index = shard_take(pShard);
+    /* Unlock shard */
+    MUX_UNLOCK(&pShard->mux);
+    if (BLOCK_NIL != index)
+    {
+        block_ready(index, 1U);
+    }
+    else
+    {
+        /* Shard exhausted */
+    }
+    return index;
+}
+
+/**
+ * @brief Allocate block from shard, shard must be locked
+ * 
+ * @param pShard Shard to allocate from
+ * @return size_t Block index, BLOCK_NIL if shard is exhausted
+ */
+static size_t shard_take(block_shard_t * pShard)
+{
+    size_t index = BLOCK_NIL;
+#if BLOCK_REMOTE_FREE && BLOCK_ADDRESS_ORDERED
+    if (BLOCK_INDEX_NIL != ATOMIC_LOAD(&pShard->remoteHead))
+    {
+        /* Remotely freed blocks may be lower than any local one */
+        (void)shard_drain_remote(pShard);
+    }
+    else
+    {
+        /* Nothing freed remotely */
+    }
+#endif
+    index = shard_pop(pShard);
+#if BLOCK_REMOTE_FREE && !BLOCK_ADDRESS_ORDERED
+    if ((BLOCK_NIL == index) && (0U != shard_drain_remote(pShard)))
+    {
+        /* Local miss, took back all blocks freed by other threads at once */
+        index = shard_pop(pShard);
+    }
+    else
+    {
+        /* Served locally or nothing freed remotely */
+    }
+#endif
+
+    if (BLOCK_NIL != index)
+    {
+        if (BLOCK_STALE != ATOMIC_LOAD(&blockUsed[index]))
+        {
+            ATOMIC_STORE(&blockStamp[index], (uint16_t)blockEpoch);
+            ATOMIC_STORE(&blockUsed[index], BLOCK_USED);
+        }
+        else
+        {
+            /* Left dirty by reset, caller clears it with block_ready() after unlocking */
+        }
+        ATOMIC_STORE(&blockRefs[index], 0U);
+        pShard->numUsed++;
+#if BLOCK_POOL_FD
+        (void)ATOMIC_FETCH_SUB(&blockFreeBlocks, 1U);
+#endif
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return index;
+}
+
+/**
+ * @brief Return block to shard free list
+ * 
+ * @param pShard Shard owning the block
+ * @param index Block index
+ * @return true Block was freed
+ * @return false Block was not in use
+ */
+static bool shard_free(block_shard_t * pShard, size_t index)
+{
+    /* Verify double free before proceeding */
+    bool freed = block_claim(index, BLOCK_FREEING);
+    if (freed)
+    {
+        /* Block is exclusively ours until it is pushed, cleared before lock so hold time is constant */
+        uint8_t * pAddr = &staticPool[index * BLOCK_STRIDE];
+        BLOCK_MEMSET(pAddr, BLOCK_SIZE, 0U);
+        /* Lock shard */
+        MUX_LOCK(&pShard->mux);
+        /* Free only together with free structure, contiguous search under lock relies on it */
+        ATOMIC_STORE(&blockUsed[index], BLOCK_UNUSED);
+        shard_push(pShard, index);
+        pShard->numUsed--; // Underflow not possible
+        /* Unlock shard */
+        MUX_UNLOCK(&pShard->mux);
+#if BLOCK_POOL_FD
+        (void)ATOMIC_FETCH_ADD(&blockFreeBlocks, 1U);
+#endif
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return freed;
+}
+
+/**
+ * @brief Take free block from shard free structure, shard must be locked
+ * 
+ * Address ordered mode descends free block tree to lowest free block in
+ * BLOCK_TREE_LEVELS steps, otherwise most recently freed block is reused.
+ * 
+ * @param pShard Shard
+ * @return size_t Block index, BLOCK_NIL if shard has no free block
+ */
+static size_t shard_pop(block_shard_t * pShard)
+{
+    size_t index = BLOCK_NIL;
+#if BLOCK_ADDRESS_ORDERED
+    if (0U != pShard->tree[0])
+    {
+        size_t local = 0U;
+        /* Lowest set bit on each level selects word on level below */
+        for (size_t level = BLOCK_TREE_LEVELS; level > 0U; level--)
+        {
+            local = (local * BLOCK_MAP_BITS) + BIT_CTZ(pShard->tree[blockTreeOffset[level - 1U] + local]);
+        }
+        index = pShard->first + local;
+        shard_unlink(pShard, index);
+    }
+#else
+    if (BLOCK_INDEX_NIL != pShard->freeHead)
+    {
+        /* Reuse most recently freed block */
+        index = pShard->freeHead;
+        shard_unlink(pShard, index);
+    }
+#endif
+    else if (pShard->bump < pShard->end)
+    {
+        /* Take block never used since init or reset, every block in free structure is lower */
+        index = pShard->bump;
+        pShard->bump++;
+        block_reclaim(pShard, index);
+    }
+    else
+    {
+        /* No memory available */
+    }
+    return index;
+}
+
+/**
+ * @brief Put block into shard free structure, shard must be locked
+ * 
+ * @param pShard Shard owning the block
+ * @param index Block index
+ */
+static void shard_push(block_shard_t * pShard, size_t index)
+{
+#if BLOCK_ADDRESS_ORDERED
+    size_t local = index - pShard->first;
+    bool wasEmpty = true;
+    /* Set block bit, propagate up while words were empty */
+    for (size_t level = 0U; (level < BLOCK_TREE_LEVELS) && wasEmpty; level++)
+    {
+        size_t word = blockTreeOffset[level] + (local / BLOCK_MAP_BITS);
+        wasEmpty = (0U == pShard->tree[word]);
+        pShard->tree[word] |= (uint32_t)1U << (local % BLOCK_MAP_BITS);
+        local /= BLOCK_MAP_BITS;
+    }
+#else
+    blockNext[index] = pShard->freeHead;
+    blockPrev[index] = BLOCK_INDEX_NIL;
+    if (BLOCK_INDEX_NIL != pShard->freeHead)
+    {
+        blockPrev[pShard->freeHead] = (block_index_t)index;
+    }
+    else
+    {
+        /* First free block */
+    }
+    pShard->freeHead = (block_index_t)index;
+#endif
+}
+
+/**
+ * @brief Prepare block reached by bump index, shard must be locked
+ * 
+ * Block left in use by pool reset is marked stale, its handles are dropped
+ * and its contents are cleared by block_ready() after unlocking. Address
+ * ordered mode clears tree words starting at block, their bits were left over
+ * from before reset.
+ * 
+ * @param pShard Shard owning the block
+ * @param index Block index, at bump index
+ */
+static void block_reclaim(block_shard_t * pShard, size_t index)
+{
+#if BLOCK_ADDRESS_ORDERED
+    size_t local = index - pShard->first;
+    size_t span = BLOCK_MAP_BITS;
+    for (size_t level = 0U; (level < BLOCK_TREE_LEVELS) && (0U == (local % span)); level++)
+    {
+        pShard->tree[blockTreeOffset[level] + (local / span)] = 0U;
+        span *= BLOCK_MAP_BITS;
+    }
+#else
+    (void)pShard;
+#endif
+    if (BLOCK_UNUSED != ATOMIC_LOAD(&blockUsed[index]))
+    {
+        /* Stale since reset, handles of previous epoch dropped now */
+        (void)ATOMIC_FETCH_ADD(&blockGen[index], 1U);
+        ATOMIC_STORE(&blockUsed[index], BLOCK_STALE);
+    }
+    else
+    {
+        /* Never used or freed before reset, already clear */
+    }
+}
+
+/**
+ * @brief Clear taken blocks left dirty by pool reset, called without shard lock
+ * 
+ * Blocks are exclusively owned by caller, so clearing them does not extend
+ * any lock hold time.
+ * 
+ * @param first First taken block
+ * @param count Number of taken blocks
+ */
+static void block_ready(size_t first, size_t count)
+{
+    for (size_t index = first; index < (first + count); index++)
+    {
+        if (BLOCK_STALE == ATOMIC_LOAD(&blockUsed[index]))
+        {
+            uint8_t * pAddr = &staticPool[index * BLOCK_STRIDE];
+            BLOCK_MEMSET(pAddr, BLOCK_SIZE, 0U);
+            ATOMIC_STORE(&blockStamp[index], (uint16_t)blockEpoch);
+            ATOMIC_STORE(&blockUsed[index], BLOCK_USED);
+        }
+        else
+        {
+            /* Clean block, already in use */
+        }
+    }
+}
+
+/**
+ * @brief Remove free block from shard free structure wherever it is, shard must be locked
+ * 
+ * Clears block bit in free block tree in address ordered mode, otherwise
+ * unlinks block from doubly linked free list. Block must not be above bump index.
+ * 
+ * @param pShard Shard owning the block
+ * @param index Block index
+ */
+static void shard_unlink(block_shard_t * pShard, size_t index)
+{
+#if BLOCK_ADDRESS_ORDERED
+    size_t local = index - pShard->first;
+    bool empty = true;
+    /* Clear block bit, propagate up while words become empty */
+    for (size_t level = 0U; (level < BLOCK_TREE_LEVELS) && empty; level++)
+    {
+        size_t word = blockTreeOffset[level] + (local / BLOCK_MAP_BITS);
+        pShard->tree[word] &= ~((uint32_t)1U << (local % BLOCK_MAP_BITS));
+        empty = (0U == pShard->tree[word]);
+        local /= BLOCK_MAP_BITS;
+    }
+#else
+    block_index_t prev = blockPrev[index];
+    block_index_t next = blockNext[index];
+    if (BLOCK_INDEX_NIL != prev)
+    {
+        blockNext[prev] = next;
+    }
+    else
+    {
+        pShard->freeHead = next;
+    }
+    if (BLOCK_INDEX_NIL != next)
+    {
+        blockPrev[next] = prev;
+    }
+    else
+    {
+        /* Last free block */
+    }
+#endif
+}
+
+/**
+ * @brief Take run of adjacent free blocks within range from shard, shard must be locked
+ * 
+ * Lowest run is taken. Free blocks of locked shard below its bump index are
+ * its blocks in unused state, so the run is searched in block states and then
+ * removed from free structure block by block. Blocks left dirty by reset are
+ * skipped until taken alone, run blocks reached by bump index may be dirty and
+ * are cleared by block_ready() after unlocking.
+ * 
+ * @param shard Shard index
+ * @param first First block of range, clipped to shard
+ * @param end One past last block of range, clipped to shard
+ * @param count Number of blocks
+ * @return size_t Index of first block, BLOCK_NIL if range has no such run
+ */
+static size_t shard_take_run(size_t shard, size_t first, size_t end, size_t count)
+{
+    block_shard_t * pShard = &blockShards[shard];
+    size_t start = BLOCK_NIL;
+    first = (first > (shard * BLOCK_SHARD_SPAN)) ? first : (shard * BLOCK_SHARD_SPAN);
+    end = (end < (size_t)pShard->end) ? end : (size_t)pShard->end;
+#if BLOCK_REMOTE_FREE
+    if (BLOCK_INDEX_NIL != ATOMIC_LOAD(&pShard->remoteHead))
+    {
+        /* Remotely freed blocks may complete a run */
+        (void)shard_drain_remote(pShard);
+    }
+    else
+    {
+        /* Nothing freed remotely */
+    }
+#endif
+    if ((first < end) && (count <= (end - first)))
+    {
+        start = run_find(first, end, pShard->bump, count);
+    }
+    else
+    {
+        /* Empty shard or run longer than shard */
+    }
+
+    if (BLOCK_NIL != start)
+    {
+        /* Blocks below bump index are in free structure, order of the rest is kept */
+        for (size_t index = start; (index < (start + count)) && (index < pShard->bump); index++)
+        {
+            shard_unlink(pShard, index);
+        }
+        if (pShard->bump < (start + count))
+        {
+            /* Run reaches blocks never used since init or reset, blocks skipped below it join free structure */
+            for (size_t index = pShard->bump; index < (start + count); index++)
+            {
+                block_reclaim(pShard, index);
+                if (index < start)
+                {
+                    shard_push(pShard, index);
+                }
+                else
+                {
+                    /* Run block */
+                }
+            }
+            pShard->bump = (block_index_t)(start + count);
+        }
+        else
+        {
+            /* Whole run was in free structure */
+        }
+        for (size_t index = start; index < (start + count); index++)
+        {
+            if (BLOCK_STALE != ATOMIC_LOAD(&blockUsed[index]))
+            {
+                ATOMIC_STORE(&blockStamp[index], (uint16_t)blockEpoch);
+                ATOMIC_STORE(&blockUsed[index], BLOCK_USED);
+            }
+            else
+            {
+                /* Left dirty by reset, caller clears it with block_ready() after unlocking */
+            }
+            ATOMIC_STORE(&blockRefs[index], 0U);
+        }
+        pShard->numUsed = (block_index_t)(pShard->numUsed + count);
+#if BLOCK_POOL_FD
+        (void)ATOMIC_FETCH_SUB(&blockFreeBlocks, count);
+#endif
+    }
+    else
+    {
+        /* No run available */
+    }
+    return start;
+}
+
+/**
+ * @brief Get free bitmap of up to 32 blocks, bit per block set when it is unused
+ * 
+ * Block states are compared 32 (AVX2) or 16 (SSE2) at a time, scalar on other targets
+ * and on the tail of range.
+ * 
+ * @param index First block
+ * @param end One past last block of range
+ * @return uint32_t Free bitmap, bits past end are clear
+ */
+static uint32_t run_free_mask(size_t index, size_t end)
+{
+    /* Plain byte reads of block states, states of free blocks can not change under shard lock */
+    const uint8_t * pStates = (const uint8_t *)(const void *)&blockUsed[index];
+    uint32_t mask = 0U;
+    size_t width = ((end - index) < BLOCK_MAP_BITS) ? (end - index) : BLOCK_MAP_BITS;
+#if defined(__AVX2__)
+    if (BLOCK_MAP_BITS == width)
+    {
+        __m256i states = _mm256_loadu_si256((const __m256i *)(const void *)pStates);
+        mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(states, _mm256_setzero_si256()));
+        width = 0U;
+    }
+    else
+    {
+        /* Tail of range */
+    }
+#elif defined(__SSE2__)
+    if (BLOCK_MAP_BITS == width)
+    {
+        __m128i low = _mm_loadu_si128((const __m128i *)(const void *)pStates);
+        __m128i high = _mm_loadu_si128((const __m128i *)(const void *)(pStates + 16U));
+        mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(low, _mm_setzero_si128())) |
+               ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_setzero_si128())) << 16);
+        width = 0U;
+    }
+    else
+    {
+        /* Tail of range */
+    }
+#endif
+    for (size_t bit = 0U; bit < width; bit++)
+    {
+        mask |= (BLOCK_UNUSED == pStates[bit]) ? ((uint32_t)1U << bit) : 0U;
+    }
+    return mask;
+}
+
+/**
+ * @brief Find lowest run of free blocks in range
+ * 
+ * Free bitmap is built 32 blocks at a time. Run continuing from previous words
+ * is extended by trailing free bits, run inside a word is found by and-ing the
+ * word with itself shifted, doubling the shift, in log2(count) steps.
+ * 
+ * @param first First block of range
+ * @param end One past last block of range
+ * @param bump Blocks from this one on are free whatever their state, it may be stale since reset
+ * @param count Run length
+ * @return size_t First block of run, BLOCK_NIL if range has no such run
+ */
+static size_t run_find(size_t first, size_t end, size_t bump, size_t count)
+{
+    size_t start = BLOCK_NIL;
+    size_t run = 0U; /* Free blocks right before current word */
+    for (size_t index = first; (index < end) && (BLOCK_NIL == start); index += BLOCK_MAP_BITS)
+    {
+        size_t width = ((end - index) < BLOCK_MAP_BITS) ? (end - index) : BLOCK_MAP_BITS;
+        uint32_t full = (BLOCK_MAP_BITS == width) ? UINT32_MAX : (((uint32_t)1U << width) - 1U);
+        uint32_t mask = run_free_mask(index, end);
+        if ((index + width) > bump)
+        {
+            size_t below = (bump > index) ? (bump - index) : 0U;
+            mask |= full & ~(uint32_t)((((uint64_t)1U) << below) - 1U);
+        }
+        else
+        {
+            /* Whole word below bump index */
+        }
+        size_t lead = (full == mask) ? width : BIT_CTZ(~mask);
+        if ((run + lead) >= count)
+        {
+            /* Run carried over from previous words completes here */
+            start = index - run;
+        }
+        else if (full == mask)
+        {
+            run += width;
+        }
+        else
+        {
+            uint32_t starts = mask;
+            size_t length = 1U;
+            while ((length < count) && (0U != starts))
+            {
+                size_t shift = ((count - length) < length) ? (count - length) : length;
+                starts &= starts >> shift;
+                length += shift;
+            }
+            if (0U != starts)
+            {
+                start = index + BIT_CTZ(starts);
+            }
+            else
+            {
+                /* Free bits above highest used block carry over to next word */
+                size_t highestUsed = (BLOCK_MAP_BITS - 1U) - BIT_CLZ(~mask & full);
+                run = width - 1U - highestUsed;
+            }
+        }
+    }
+    return start;
+}
+
+/**
+ * @brief Account run of blocks to default tenant and normal priority
+ * 
+ * @param count Number of blocks
+ * @return true Every block admitted
+ * @return false Refused, nothing accounted
+ */
+static bool run_admit(size_t count)
+{
+    size_t admitted = count;
+#if BLOCK_ADMISSION
+    bool accepted = true;
+    admitted = 0U;
+    while ((admitted < count) && accepted)
+    {
+#if (BLOCK_TENANTS > 0U)
+        accepted = tenant_admit(&blockTenants[BLOCK_TENANT_DEFAULT]);
+#endif
+#if BLOCK_PRIORITY
+        if (accepted && !prio_admit(BLOCK_PRIO_NORMAL))
+        {
+#if (BLOCK_TENANTS > 0U)
+            tenant_release(&blockTenants[BLOCK_TENANT_DEFAULT]);
+#endif
+            accepted = false;
+        }
+        else
+        {
+            /* Admitted or refused by tenant */
+        }
+#endif
+        admitted += accepted ? 1U : 0U;
+    }
+    if (admitted < count)
+    {
+        run_release(admitted);
+    }
+    else
+    {
+        /* Whole run admitted */
+    }
+#endif
+    return (admitted == count);
+}
+
+/**
+ * @brief Return admission of blocks accounted by run_admit()
+ * 
+ * @param count Number of blocks
+ */
+static void run_release(size_t count)
+{
+    for (size_t block = 0U; block < count; block++)
+    {
+#if (BLOCK_TENANTS > 0U)
+        tenant_release(&blockTenants[BLOCK_TENANT_DEFAULT]);
+#endif
+#if BLOCK_PRIORITY
+        (void)ATOMIC_FETCH_SUB(&blockPrioUsed, 1U);
+#endif
+    }
+}
+
+/**
+ * @brief Return claimed and cleared block of ending scope to its shard
+ * 
+ * Lock of previous block shard is kept while blocks belong to it and switched
+ * otherwise, caller unlocks the last one.
+ * 
+ * @param index Block index, in freeing state
+ * @param pLocked Shard currently locked, BLOCK_NIL if none
+ */
+static void scope_push(size_t index, size_t * pLocked)
+{
+    size_t shard = BLOCK_INDEX_2_SHARD(index);
+    if (shard != *pLocked)
+    {
+        if (BLOCK_NIL != *pLocked)
+        {
+            MUX_UNLOCK(&blockShards[*pLocked].mux);
+        }
+        else
+        {
+            /* First block */
+        }
+        MUX_LOCK(&blockShards[shard].mux);
+        *pLocked = shard;
+    }
+    else
+    {
+        /* Same shard as previous block */
+    }
+#if (BLOCK_TENANTS > 0U)
+    /* Read before block is free, it may be reallocated right after */
+    tenant_release(&blockTenants[blockTenantOf[index]]);
+#endif
+    ATOMIC_STORE(&blockUsed[index], BLOCK_UNUSED);
+    shard_push(&blockShards[shard], index);
+    blockShards[shard].numUsed--; // Underflow not possible
+#if BLOCK_POOL_FD
+    (void)ATOMIC_FETCH_ADD(&blockFreeBlocks, 1U);
+#endif
+}
+
+/**
+ * @brief Return blocks freed by signal handlers to their shards, regular context only
+ * 
+ * Blocks not merged within limit stay detached for next merge, so allocation
+ * work stays bounded however many blocks handlers freed meanwhile.
+ * 
+ * @param limit Maximum number of blocks to merge
+ */
+static void block_merge_deferred(size_t limit)
+{
+    bool pending = (BLOCK_INDEX_NIL != ATOMIC_LOAD(&blockDeferredHead)) ||
+                   (BLOCK_INDEX_NIL != ATOMIC_LOAD(&blockMergeHead));
+    if (pending && MUX_TRYLOCK(&blockMergeMux))
+    {
+        block_index_t index = ATOMIC_LOAD(&blockMergeHead);
+        block_index_t last = BLOCK_INDEX_NIL;
+        block_index_t rest = BLOCK_INDEX_NIL;
+        if (BLOCK_INDEX_NIL == index)
+        {
+            /* Detach whole list with single exchange, handlers keep pushing onto empty one */
+            index = ATOMIC_XCHG(&blockDeferredHead, BLOCK_INDEX_NIL);
+        }
+        else
+        {
+            /* Leftover of previous merge first */
+        }
+        /* Split off at most limit blocks */
+        rest = index;
+        for (size_t count = 0U; (count < limit) && (BLOCK_INDEX_NIL != rest); count++)
+        {
+            last = rest;
+            rest = blockNext[rest];
+        }
+        if (BLOCK_INDEX_NIL != last)
+        {
+            blockNext[last] = BLOCK_INDEX_NIL;
+        }
+        else
+        {
+            /* Handlers freed nothing since pending check */
+        }
+        ATOMIC_STORE(&blockMergeHead, rest);
+        /* Released without merge lock, shard locks are never nested */
+        MUX_UNLOCK(&blockMergeMux);
+        while (BLOCK_INDEX_NIL != index)
+        {
+            block_index_t next = blockNext[index];
+            /* Back in use so regular free path releases block and its counters */
+            ATOMIC_STORE(&blockUsed[index], BLOCK_USED);
+#if BLOCK_POOL_FD
+            (void)ATOMIC_FETCH_SUB(&blockFreeBlocks, 1U);
+#endif
+            (void)block_release(index);
+            index = next;
+        }
+    }
+    else
+    {
+        /* Nothing freed by handlers or other thread merging */
+    }
+}
+
+#endif
+
+/**
+ * @brief Take free block if priority admission allows it
+ * 
+ * @param prio Allocation priority
+ * @return size_t Block index, BLOCK_NIL if no block is available for priority
+ */
+static size_t block_acquire(block_prio_t prio)
+{
+    size_t index = BLOCK_NIL;
+#if BLOCK_PRIORITY
+    if (prio_admit(prio))
+#else
+    (void)prio;
+#endif
+    {
+        index = block_take();
+#if BLOCK_ADMISSION
+        /* Counters are released only after block is back in pool, so admission guarantees a free
+         * block, retry until it is found while it is in flight on a free path or taken by a stealer */
+        while (BLOCK_NIL == index)
+        {
+            index = block_take();
+        }
+#endif
+#if BLOCK_PRIORITY
+        if (BLOCK_NIL == index)
+        {
+            (void)ATOMIC_FETCH_SUB(&blockPrioUsed, 1U);
+        }
+        else
+        {
+            /* Do nothing */
+        }
+#endif
+    }
+#if BLOCK_PRIORITY
+    else
+    {
+        /* Only emergency reserve left */
+        (void)ATOMIC_FETCH_ADD(&blockReserveRejected, 1U);
+        block_notify_exhausted();
+    }
+#endif
+    return index;
+}
+
+/**
+ * @brief Take free block from home shard/sub-pool, other shards on miss
+ * 
+ * @return size_t Block index, BLOCK_NIL if pool is exhausted
+ */
+static size_t block_take(void)
+{
+    size_t index = BLOCK_NIL;
+    size_t home = shard_home();
+#if BLOCK_WORK_STEALING
+    index = subpool_alloc(&blockShards[home], home);
+#else
+    /* Home shard first, then steal from nearest neighbours so whole pool stays usable */
+    do
+    {
+        for (size_t offset = 0U; (offset < (size_t)BLOCK_SHARDS) && (BLOCK_NIL == index); offset++)
+        {
+            index = shard_alloc(&blockShards[shard_neighbour(home, offset)]);
+            if (BLOCK_NIL != index)
+            {
+                /* Block found */
+                if (0U != offset)
+                {
+                    (void)ATOMIC_FETCH_ADD(&blockSteals, 1U);
+                    (void)ATOMIC_FETCH_ADD(&blockStolen, 1U);
+                }
+                else
+                {
+                    /* Served by home shard */
+                }
+            }
+            else if (0U == offset)
+            {
+                /* Home shard exhausted */
+                (void)ATOMIC_FETCH_ADD(&blockStealAttempts, 1U);
+            }
+            else
+            {
+                /* No free blocks in shard */
+            }
+        }
+    } while ((BLOCK_NIL == index) && trim_busy()); /* Blocks held by trim pass are not exhaustion */
+#endif
+
+    if (BLOCK_NIL == index)
+    {
+        block_notify_exhausted();
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return index;
+}
+
+/**
+ * @brief Take free block without waiting for any lock, async-signal-safe
+ * 
+ * @return size_t Block index, BLOCK_NIL if pool is exhausted or shards are busy
+ */
+static size_t block_try_take(void)
+{
+    size_t index = BLOCK_NIL;
+    size_t home = shard_home();
+#if BLOCK_WORK_STEALING
+    /* Sub-pools are lock-free */
+    index = subpool_alloc(&blockShards[home], home);
+#else
+    for (size_t offset = 0U; (offset < (size_t)BLOCK_SHARDS) && (BLOCK_NIL == index); offset++)
+    {
+        block_shard_t * pShard = &blockShards[shard_neighbour(home, offset)];
+        if (MUX_TRYLOCK(&pShard->mux))
+        {
+            index = shard_take(pShard);
+            MUX_UNLOCK(&pShard->mux);
+            if (BLOCK_NIL != index)
+            {
+                block_ready(index, 1U);
+            }
+            else
+            {
+                /* Shard exhausted */
+            }
+        }
+        else
+        {
+            /* Shard busy, possibly held by interrupted thread */
+        }
+    }
+#endif
+    return index;
+}
+
+/**
+ * @brief Return block to its shard/sub-pool
+ * 
+ * @param index Block index
+ * @return true Block was freed
+ * @return false Block was not in use (double free)
+ */
+static bool block_put(size_t index)
+{
+    bool freed = false;
+#if BLOCK_WORK_STEALING
+    /* Freed block joins sub-pool of the freeing thread */
+    freed = subpool_free(&blockShards[shard_home()], index);
+#else
+    size_t shard = BLOCK_INDEX_2_SHARD(index);
+#if BLOCK_REMOTE_FREE
+    if (shard != shard_home())
+    {
+        /* Non-owner, hand block back without taking owner lock */
+        freed = shard_free_remote(&blockShards[shard], index);
+    }
+    else
+#endif
+    {
+        freed = shard_free(&blockShards[shard], index);
+    }
+#endif
+    return freed;
+}
+
+/**
+ * @brief Return block to pool and release its admission counters
+ * 
+ * @param index Block index
+ * @return true Block was freed
+ * @return false Block was not in use (double free)
+ */
+static bool block_release(size_t index)
+{
+#if (BLOCK_TENANTS > 0U)
+    /* Read before block is returned, it may be reallocated right after */
+    size_t tenant = blockTenantOf[index];
+#endif
+    bool freed = block_put(index);
+    if (freed)
+    {
+#if (BLOCK_TENANTS > 0U)
+        tenant_release(&blockTenants[tenant]);
+#endif
+#if BLOCK_PRIORITY
+        (void)ATOMIC_FETCH_SUB(&blockPrioUsed, 1U);
+#endif
+        block_notify_free();
+    }
+    else
+    {
+        /* Double free, nothing to notify */
+    }
+    return freed;
+}
+
+/**
+ * @brief Return every block to the pool and clear it, allocator configuration is kept
+ */
+static void block_reset_pool(void)
+{
+    /* Initialize blocks to default value */
+    BLOCK_MEMSET(staticPool, sizeof(staticPool), 0U);
+    for (size_t index = 0U; index < (size_t)BLOCK_NUMS; index++)
+    {
+        ATOMIC_STORE(&blockUsed[index], BLOCK_UNUSED);
+        /* Handles taken before init or reset become stale */
+        (void)ATOMIC_FETCH_ADD(&blockGen[index], 1U);
+    }
+    for (size_t shard = 0U; shard < (size_t)BLOCK_SHARDS; shard++)
+    {
+        shard_reset(shard);
+    }
+#if !BLOCK_WORK_STEALING
+    ATOMIC_STORE(&blockDeferredHead, BLOCK_INDEX_NIL);
+    ATOMIC_STORE(&blockMergeHead, BLOCK_INDEX_NIL);
+#endif
+#if BLOCK_POOL_FD
+    ATOMIC_STORE(&blockFreeBlocks, (size_t)BLOCK_NUMS);
+#endif
+}
+
+/**
+ * @brief Give shard/sub-pool its whole slice of the pool back, blocks are not touched
+ * 
+ * Shard starts over from its bump index, address ordered tree words below top
+ * are cleared as the bump index reaches them. Sub-pool map is refilled with
+ * its slice a word at a time.
+ * 
+ * @param shard Shard index
+ */
+static void shard_reset(size_t shard)
+{
+    size_t first = shard * BLOCK_SHARD_SPAN;
+    size_t end = first + BLOCK_SHARD_SPAN;
+    first = (first < (size_t)BLOCK_NUMS) ? first : (size_t)BLOCK_NUMS;
+    end = (end < (size_t)BLOCK_NUMS) ? end : (size_t)BLOCK_NUMS;
+#if BLOCK_WORK_STEALING
+    /* Sub-pool starts with its own slice of the pool */
+    for (size_t word = 0U; word < BLOCK_MAP_WORDS; word++)
+    {
+        size_t low = word * BLOCK_MAP_BITS;
+        size_t high = low + BLOCK_MAP_BITS;
+        uint32_t bits = 0U;
+        low = (low > first) ? low : first;
+        high = (high < end) ? high : end;
+        if (low < high)
+        {
+            bits = (BLOCK_MAP_BITS == (high - low)) ? UINT32_MAX : (((uint32_t)1U << (high - low)) - 1U);
+            bits <<= low % BLOCK_MAP_BITS;
+        }
+        else
+        {
+            /* Word outside slice */
+        }
+        ATOMIC_STORE(&blockShards[shard].freeMap[word], bits);
+    }
+    ATOMIC_STORE(&blockShards[shard].numUsed, 0U);
+#else
+#if BLOCK_ADDRESS_ORDERED
+    blockShards[shard].tree[0] = 0U;
+    blockShards[shard].first = (block_index_t)first;
+#else
+    blockShards[shard].freeHead = BLOCK_INDEX_NIL;
+#endif
+    blockShards[shard].bump = (block_index_t)first;
+    blockShards[shard].end = (block_index_t)end;
+    blockShards[shard].numUsed = 0U;
+#if BLOCK_REMOTE_FREE
+    ATOMIC_STORE(&blockShards[shard].remoteHead, BLOCK_INDEX_NIL);
+#endif
+#endif
+}
+
+/**
+ * @brief Count used blocks, blocks waiting on remote free stacks are reclaimed first
+ * 
+ * @return size_t Number of used blocks
+ */
+static size_t block_count_used(void)
+{
+    size_t used = 0U;
+#if !BLOCK_WORK_STEALING
+    block_merge_deferred((size_t)BLOCK_NUMS);
+#endif
+    for (size_t shard = 0U; shard < (size_t)BLOCK_SHARDS; shard++)
+    {
+#if BLOCK_WORK_STEALING
+        used += ATOMIC_LOAD(&blockShards[shard].numUsed);
+#else
+        MUX_LOCK(&blockShards[shard].mux);
+#if BLOCK_REMOTE_FREE
+        (void)shard_drain_remote(&blockShards[shard]);
+#endif
+        used += blockShards[shard].numUsed;
+        MUX_UNLOCK(&blockShards[shard].mux);
+#endif
+    }
+    return used;
+}
+
+/**
+ * @brief Notify waiters and pool descriptor that a block was freed
+ */
+static void block_notify_free(void)
+{
+#if BLOCK_WAIT
+    /* Single load each when nobody waits */
+    if (0U != ATOMIC_LOAD_SEQ_CST(&blockWaiters))
+    {
+        block_wake();
+    }
+    else
+    {
+        /* No waiters */
+    }
+#endif
+#if BLOCK_POOL_FD
+    if (0U != ATOMIC_LOAD_SEQ_CST(&blockFdArmed))
+    {
+        block_fd_check();
+    }
+    else
+    {
+        /* Not exhausted since last notification */
+    }
+#endif
+}
+
+/**
+ * @brief Arm pool descriptor notification after allocation failed
+ */
+static void block_notify_exhausted(void)
+{
+#if BLOCK_POOL_FD
+    if ((0 <= ATOMIC_LOAD(&blockPoolFd)) && (0U == ATOMIC_LOAD(&blockFdArmed)))
+    {
+        (void)ATOMIC_XCHG(&blockFdArmed, 1U);
+        /* Blocks freed before arming would never notify, check once more */
+        block_fd_check();
+    }
+    else
+    {
+        /* Descriptor not used or already armed */
+    }
+#endif
+}
+
+#if BLOCK_POOL_FD
+/**
+ * @brief Signal pool descriptor once free blocks are above low watermark
+ * 
+ * Reads free block counter only, no shard lock is taken, so the check is
+ * constant time and async-signal-safe.
+ */
+static void block_fd_check(void)
+{
+    if (ATOMIC_LOAD(&blockFreeBlocks) > ATOMIC_LOAD(&blockLowWatermark))
+    {
+        uint8_t expected = 1U;
+        if (ATOMIC_CAS(&blockFdArmed, &expected, 0U))
+        {
+            uint64_t one = 1U;
+            /* eventfd counter never overflows here, pipe may be full which is fine */
+            (void)write(blockPoolFdWrite, &one, sizeof(one));
+        }
+        else
+        {
+            /* Other thread notified */
+        }
+    }
+    else
+    {
+        /* Still under memory pressure */
+    }
+}
+#endif
+
+#if (BLOCK_TENANTS > 0U)
+/**
+ * @brief Account one block to tenant if reservation, cap and shared capacity allow
+ * 
+ * Shared counter is taken before tenant counter so it may only be transiently
+ * over-counted, never under-counted, and pool can not be over-committed.
+ * 
+ * @param pTenant Tenant
+ * @return true Block accounted to tenant
+ * @return false Tenant cap or shared capacity exhausted
+ */
+static bool tenant_admit(block_tenant_t * pTenant)
+{
+    bool admitted = false;
+    bool done = false;
+    size_t used = ATOMIC_LOAD(&pTenant->used);
+    while (!done)
+    {
+        if (used >= pTenant->limit)
+        {
+            /* Hard cap reached */
+            done = true;
+        }
+        else if (used < pTenant->reserved)
+        {
+            /* Within reservation, shared capacity not touched, retry only if tenant raced itself */
+            admitted = ATOMIC_CAS(&pTenant->used, &used, used + 1U);
+            done = admitted;
+        }
+        else
+        {
+            size_t shared = ATOMIC_LOAD(&blockSharedUsed);
+            if (shared >= blockSharedCap)
+            {
+                /* Shared capacity exhausted */
+                done = true;
+            }
+            else if (ATOMIC_CAS(&blockSharedUsed, &shared, shared + 1U))
+            {
+                admitted = ATOMIC_CAS(&pTenant->used, &used, used + 1U);
+                if (!admitted)
+                {
+                    /* Tenant count changed, return shared slot and decide again */
+                    (void)ATOMIC_FETCH_SUB(&blockSharedUsed, 1U);
+                }
+                else
+                {
+                    /* Do nothing */
+                }
+                done = admitted;
+            }
+            else
+            {
+                /* Shared counter changed, retry */
+            }
+        }
+    }
+    return admitted;
+}
+
+/**
+ * @brief Return one block of tenant, block must already be back in pool
+ * 
+ * @param pTenant Tenant
+ */
+static void tenant_release(block_tenant_t * pTenant)
+{
+    size_t used = ATOMIC_FETCH_SUB(&pTenant->used, 1U);
+    if (used > pTenant->reserved)
+    {
+        /* Block was above reservation */
+        (void)ATOMIC_FETCH_SUB(&blockSharedUsed, 1U);
+    }
+    else
+    {
+        /* Block was within reservation */
+    }
+}
+
+/**
+ * @brief Allocate single block on behalf of tenant with given priority
+ * 
+ * @param tenant Tenant ID
+ * @param prio Allocation priority
+ * @return void* Pointer to allocated block, NULL if tenant cap or pool is exhausted
+ */
+static void * tenant_alloc(size_t tenant, block_prio_t prio)
+{
+    uint8_t * pAddr = NULL;
+    if ((tenant < (size_t)BLOCK_TENANTS) && tenant_admit(&blockTenants[tenant]))
+    {
+        size_t index = block_acquire(prio);
+        if (BLOCK_NIL != index)
+        {
+            blockTenantOf[index] = (uint8_t)tenant;
+            pAddr = &staticPool[index * BLOCK_STRIDE];
+        }
+        else
+        {
+            tenant_release(&blockTenants[tenant]);
+        }
+    }
+    else if (tenant < (size_t)BLOCK_TENANTS)
+    {
+        /* Refused by cap or shared capacity */
+        (void)ATOMIC_FETCH_ADD(&blockTenants[tenant].rejected, 1U);
+        if (ATOMIC_LOAD(&blockSharedUsed) >= blockSharedCap)
+        {
+            /* Unreserved part of pool exhausted */
+            block_notify_exhausted();
+        }
+        else
+        {
+            /* Only tenant cap reached */
+        }
+    }
+    else
+    {
+        /* Invalid tenant */
+    }
+    return pAddr;
+}
+#endif
+
+#if BLOCK_PRIORITY
+/**
+ * @brief Account one block if it does not cut into reserve of higher priority
+ * 
+ * @param prio Allocation priority
+ * @return true Block accounted
+ * @return false Only emergency reserve left for priority, or pool exhausted
+ */
+static bool prio_admit(block_prio_t prio)
+{
+    size_t reserve = ATOMIC_LOAD(&blockReserve);
+    size_t limit = (BLOCK_PRIO_HIGH == prio) ? (size_t)BLOCK_NUMS : ((size_t)BLOCK_NUMS - reserve);
+    size_t used = ATOMIC_LOAD(&blockPrioUsed);
+    bool admitted = false;
+    while ((used < limit) && !admitted)
+    {
+        /* Failed CAS reloads counter */
+        admitted = ATOMIC_CAS(&blockPrioUsed, &used, used + 1U);
+    }
+    return admitted;
+}
+#endif
+
+#if BLOCK_PREFAULT
+/**
+ * @brief Fault in side arrays not written by init and lock pool with metadata in memory
+ * 
+ * Pool itself was faulted in by init memset. Static arrays are not mapped by
+ * allocator, so MAP_POPULATE does not apply and pages are touched instead.
+ */
+static void block_prefault(void)
+{
+    size_t locked = 0U;
+#if !BLOCK_WORK_STEALING
+    BLOCK_MEMSET(blockNext, sizeof(blockNext), 0U);
+    locked += block_lock_range(blockNext, sizeof(blockNext));
+#if !BLOCK_ADDRESS_ORDERED
+    BLOCK_MEMSET(blockPrev, sizeof(blockPrev), 0U);
+    locked += block_lock_range(blockPrev, sizeof(blockPrev));
+#endif
+#endif
+#if (BLOCK_TENANTS > 0U)
+    BLOCK_MEMSET(blockTenantOf, sizeof(blockTenantOf), 0U);
+    locked += block_lock_range(blockTenantOf, sizeof(blockTenantOf));
+    locked += block_lock_range(blockTenants, sizeof(blockTenants));
+#endif
+    locked += block_lock_range(staticPool, sizeof(staticPool));
+    locked += block_lock_range((const void *)blockUsed, sizeof(blockUsed));
+    locked += block_lock_range((const void *)blockGen, sizeof(blockGen));
+    locked += block_lock_range((const void *)blockStamp, sizeof(blockStamp));
+    locked += block_lock_range((const void *)blockRefs, sizeof(blockRefs));
+    locked += block_lock_range(blockShards, sizeof(blockShards));
+    blockLockedBytes = locked;
+}
+
+/**
+ * @brief Lock memory range, whole pages containing it are locked
+ * 
+ * @param pStart Start of range
+ * @param size Size of range in bytes
+ * @return size_t Bytes locked, 0 if locking failed e.g. RLIMIT_MEMLOCK
+ */
+static size_t block_lock_range(const void * pStart, size_t size)
+{
+    return (0 == mlock(pStart, size)) ? size : 0U;
+}
+#endif
+
+#if BLOCK_TRIM
+/**
+ * @brief Count resident bytes of pool, trim mutex must be held
+ * 
+ * @return size_t Resident bytes
+ */
+static size_t block_resident(void)
+{
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = (sizeof(staticPool) + pageSize - 1U) / pageSize;
+    size_t resident = 0U;
+    if (0 == mincore(staticPool, sizeof(staticPool), blockPageVec))
+    {
+        for (size_t page = 0U; page < pages; page++)
+        {
+            resident += (0U != (blockPageVec[page] & 1U)) ? pageSize : 0U;
+        }
+    }
+    else
+    {
+        /* Residency unknown, assume whole pool */
+        resident = pages * pageSize;
+    }
+    return resident;
+}
+
+/**
+ * @brief Background trim, runs periodically while pool has enough free blocks
+ * 
+ * @param pArg Unused
+ * @return void* NULL
+ */
+static void * trim_thread(void * pArg)
+{
+    (void)pArg;
+    pthread_mutex_lock(&blockTrimMux);
+    while (0U != blockTrimPolicy.intervalMs)
+    {
+        struct timespec deadline;
+        uint64_t nsec = 0U;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        nsec = (uint64_t)deadline.tv_nsec + ((uint64_t)blockTrimPolicy.intervalMs * 1000000U);
+        deadline.tv_sec += (time_t)(nsec / 1000000000U);
+        deadline.tv_nsec = (long)(nsec % 1000000000U);
+        if ((ETIMEDOUT == pthread_cond_timedwait(&blockTrimCond, &blockTrimMux, &deadline)) &&
+            (0U != blockTrimPolicy.intervalMs))
+        {
+            size_t minFree = blockTrimPolicy.minFreeBlocks;
+            pthread_mutex_unlock(&blockTrimMux);
+            if (((size_t)BLOCK_NUMS - block_count_used()) >= minFree)
+            {
+                (void)block_trim();
+            }
+            else
+            {
+                /* Pool busy, pages would be faulted back soon */
+            }
+            pthread_mutex_lock(&blockTrimMux);
+        }
+        else
+        {
+            /* Policy changed, recompute deadline */
+        }
+    }
+    pthread_mutex_unlock(&blockTrimMux);
+    return NULL;
+}
+
+#if !BLOCK_WORK_STEALING && !BLOCK_PREFAULT
+/**
+ * @brief Check without locks that blocks are free, taking them decides
+ * 
+ * @param first First block
+ * @param end Block after last
+ * @return true Every block is free
+ * @return false Range holds used block
+ */
+static bool trim_range_free(size_t first, size_t end)
+{
+    bool rangeFree = true;
+    for (size_t index = first; (index < end) && rangeFree; index++)
+    {
+        uint8_t state = ATOMIC_LOAD(&blockUsed[index]);
+        /* Remotely freed blocks are drained back by taking them */
+        rangeFree = (BLOCK_UNUSED == state) || (BLOCK_REMOTE == state);
+    }
+    return rangeFree;
+}
+
+/**
+ * @brief Take free blocks off their shards so they can not be allocated while their pages are trimmed
+ * 
+ * Each shard lock is held only while its part of the range is taken.
+ * 
+ * @param first First block
+ * @param end Block after last
+ * @return true Every block taken
+ * @return false Some block is in use, nothing taken
+ */
+static bool trim_take(size_t first, size_t end)
+{
+    bool taken = true;
+    size_t start = first;
+    while ((start < end) && taken)
+    {
+        size_t shard = BLOCK_INDEX_2_SHARD(start);
+        size_t shardEnd = (shard + 1U) * BLOCK_SHARD_SPAN;
+        shardEnd = (shardEnd < end) ? shardEnd : end;
+        /* Counted before taking, allocation missing these blocks then waits instead of failing */
+        (void)ATOMIC_FETCH_ADD(&blockTrimHeld, shardEnd - start);
+        MUX_LOCK(&blockShards[shard].mux);
+        taken = (BLOCK_NIL != shard_take_run(shard, start, shardEnd, shardEnd - start));
+        MUX_UNLOCK(&blockShards[shard].mux);
+        if (taken)
+        {
+            start = shardEnd;
+        }
+        else
+        {
+            /* Allocated meanwhile, part taken from previous shards goes back */
+            (void)ATOMIC_FETCH_SUB(&blockTrimHeld, shardEnd - start);
+            trim_return(first, start);
+        }
+    }
+    return taken;
+}
+
+/**
+ * @brief Return blocks taken by trim_take() to their shards, contents are kept as trimmed pages read zero
+ * 
+ * @param first First block
+ * @param end Block after last
+ */
+static void trim_return(size_t first, size_t end)
+{
+    size_t start = first;
+    while (start < end)
+    {
+        size_t shard = BLOCK_INDEX_2_SHARD(start);
+        size_t shardEnd = (shard + 1U) * BLOCK_SHARD_SPAN;
+        shardEnd = (shardEnd < end) ? shardEnd : end;
+        MUX_LOCK(&blockShards[shard].mux);
+        for (size_t index = start; index < shardEnd; index++)
+        {
+            ATOMIC_STORE(&blockUsed[index], BLOCK_UNUSED);
+            shard_push(&blockShards[shard], index);
+        }
+        blockShards[shard].numUsed = (block_index_t)(blockShards[shard].numUsed - (shardEnd - start));
+        MUX_UNLOCK(&blockShards[shard].mux);
+        (void)ATOMIC_FETCH_SUB(&blockTrimHeld, shardEnd - start);
+#if BLOCK_POOL_FD
+        (void)ATOMIC_FETCH_ADD(&blockFreeBlocks, shardEnd - start);
+#endif
+        start = shardEnd;
+    }
+}
+#endif
+#endif
+
+#if !BLOCK_WORK_STEALING
+/**
+ * @brief Check if trim pass holds free blocks, allocation finding none waits for them as for a busy shard
+ * 
+ * @return true Trim pass holds free blocks
+ * @return false No blocks held, pool is exhausted indeed
+ */
+static bool trim_busy(void)
+{
+    bool busy = false;
+#if BLOCK_TRIM && !BLOCK_PREFAULT
+    busy = (0U != ATOMIC_LOAD(&blockTrimHeld));
+#endif
+    return busy;
+}
+#endif
+
+#if BLOCK_WAIT
+/**
+ * @brief Wake oldest waiter not woken yet
+ */
+static void block_wake(void)
+{
+    pthread_mutex_lock(&blockWaitMux);
+    block_waiter_t * pWaiter = pWaitHead;
+    while ((NULL != pWaiter) && pWaiter->signaled)
+    {
+        pWaiter = pWaiter->pNext;
+    }
+    if (NULL != pWaiter)
+    {
+        pWaiter->signaled = true;
+        pthread_cond_signal(&pWaiter->cond);
+    }
+    else
+    {
+        /* Every waiter already has pending wake-up */
+    }
+    pthread_mutex_unlock(&blockWaitMux);
+}
+
+/**
+ * @brief Advance monotonic time, saturates at far future for BLOCK_WAIT_FOREVER
+ * 
+ * @param pTime Time to advance
+ * @param ns Nanoseconds to add
+ */
+static void wait_add_ns(struct timespec * pTime, uint64_t ns)
+{
+    if ((uint64_t)BLOCK_WAIT_FOREVER != ns)
+    {
+        uint64_t nsec = (uint64_t)pTime->tv_nsec + (ns % 1000000000U);
+        pTime->tv_sec += (time_t)(ns / 1000000000U) + (time_t)(nsec / 1000000000U);
+        pTime->tv_nsec = (long)(nsec % 1000000000U);
+    }
+    else
+    {
+        /* Never reached, retries keep waiter going */
+        pTime->tv_sec = (time_t)INT32_MAX;
+        pTime->tv_nsec = 0;
+    }
+}
+#endif
+
+/**
+ * @brief Move used block to new state, fails if block is not in use (double free)
+ * 
+ * @param index Block index
+ * @param state New block state
+ * @return true Block was used and is now owned by caller
+ * @return false Block was not in use
+ */
+static bool block_claim(size_t index, uint8_t state)
+{
+    uint8_t expected = BLOCK_USED;
+    /* Stamp is stored before used state, blocks stale since reset keep stamp of their epoch */
+    return ((uint16_t)blockEpoch == ATOMIC_LOAD(&blockStamp[index])) && ATOMIC_CAS(&blockUsed[index], &expected, state);
+}
+
+/**
+ * @brief Check block is in use and was allocated after last pool reset
+ * 
+ * @param index Block index
+ * @return true Block is in use in current pool epoch
+ * @return false Block is free, being freed or stale since reset
+ */
+static bool block_live(size_t index)
+{
+    return (BLOCK_USED == ATOMIC_LOAD(&blockUsed[index])) && ((uint16_t)blockEpoch == ATOMIC_LOAD(&blockStamp[index]));
+}
+
+/**
+ * @brief Advance generation of used block so its handles become stale
+ * 
+ * Generation is read before the state and advanced with a CAS, so of
+ * concurrent frees of the same block only one succeeds and a double free
+ * leaves the generation unchanged.
+ * 
+ * @param index Block index
+ * @param gen Generation expected, of handle or loaded by caller before the call
+ * @return true Generation advanced, caller may claim block
+ * @return false Block was not in use, generation differs or block was freed concurrently
+ */
+static bool block_retire(size_t index, uint8_t gen)
+{
+    return block_live(index) && ATOMIC_CAS(&blockGen[index], &gen, (uint8_t)(gen + 1U));
+}
+
+#if BLOCK_REMOTE_FREE
+/**
+ * @brief Push block onto owner shard remote free stack, lock-free
+ * 
+ * @param pShard Shard owning the block
+ * @param index Block index
+ * @return true Block was freed
+ * @return false Block was not in use
+ */
+static bool shard_free_remote(block_shard_t * pShard, size_t index)
+{
+    /* Verify double free before proceeding */
+    bool freed = block_claim(index, BLOCK_REMOTE);
+    if (freed)
+    {
+        /* Block is exclusively ours until it is published on the stack */
+        uint8_t * pAddr = &staticPool[index * BLOCK_STRIDE];
+        BLOCK_MEMSET(pAddr, BLOCK_SIZE, 0U);
+        block_index_t head = ATOMIC_LOAD(&pShard->remoteHead);
+        do
+        {
+            blockNext[index] = head;
+        } while (!ATOMIC_CAS(&pShard->remoteHead, &head, (block_index_t)index));
+#if BLOCK_POOL_FD
+        (void)ATOMIC_FETCH_ADD(&blockFreeBlocks, 1U);
+#endif
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return freed;
+}
+
+/**
+ * @brief Move all remotely freed blocks to local free list, shard must be locked
+ * 
+ * @param pShard Shard to drain
+ * @return size_t Number of blocks reclaimed
+ */
+static size_t shard_drain_remote(block_shard_t * pShard)
+{
+    size_t count = 0U;
+    /* Detach whole stack with single exchange, pushers never block the owner */
+    block_index_t index = ATOMIC_XCHG(&pShard->remoteHead, BLOCK_INDEX_NIL);
+    while (BLOCK_INDEX_NIL != index)
+    {
+        block_index_t next = blockNext[index];
+        ATOMIC_STORE(&blockUsed[index], BLOCK_UNUSED);
+        shard_push(pShard, index);
+        count++;
+        index = next;
+    }
+    pShard->numUsed = (block_index_t)(pShard->numUsed - count);
+    return count;
+}
+#endif
+
+#if BLOCK_WORK_STEALING
+/**
+ * @brief Allocate single block from sub-pool, steal from other sub-pool on local miss
+ * 
+ * @param pShard Sub-pool of calling thread
+ * @param home Index of calling thread sub-pool
+ * @return size_t Block index, BLOCK_NIL if pool is exhausted
+ */
+static size_t subpool_alloc(block_shard_t * pShard, size_t home)
+{
+    size_t index = subpool_take(pShard);
+    if (BLOCK_NIL == index)
+    {
+        /* Local free blocks ran dry */
+        (void)ATOMIC_FETCH_ADD(&blockStealAttempts, 1U);
+        size_t stolen = subpool_steal(pShard, home);
+        if (0U < stolen)
+        {
+            (void)ATOMIC_FETCH_ADD(&blockSteals, 1U);
+            (void)ATOMIC_FETCH_ADD(&blockStolen, stolen);
+            index = subpool_take(pShard);
+        }
+        else
+        {
+            /* No memory available */
+        }
+    }
+    else
+    {
+        /* Served locally */
+    }
+
+    if (BLOCK_NIL != index)
+    {
+        if (BLOCK_UNUSED != ATOMIC_LOAD(&blockUsed[index]))
+        {
+            /* Left in use by reset, exclusively ours once its bit is taken */
+            uint8_t * pAddr = &staticPool[index * BLOCK_STRIDE];
+            (void)ATOMIC_FETCH_ADD(&blockGen[index], 1U);
+            BLOCK_MEMSET(pAddr, BLOCK_SIZE, 0U);
+        }
+        else
+        {
+            /* Cleared when freed */
+        }
+        ATOMIC_STORE(&blockStamp[index], (uint16_t)blockEpoch);
+        ATOMIC_STORE(&blockUsed[index], BLOCK_USED);
+        ATOMIC_STORE(&blockRefs[index], 0U);
+        (void)ATOMIC_FETCH_ADD(&pShard->numUsed, 1U);
+#if BLOCK_POOL_FD
+        (void)ATOMIC_FETCH_SUB(&blockFreeBlocks, 1U);
+#endif
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return index;
+}
+
+/**
+ * @brief Take lowest free block of sub-pool, lock-free
+ * 
+ * @param pShard Sub-pool
+ * @return size_t Block index, BLOCK_NIL if sub-pool is empty
+ */
+static size_t subpool_take(block_shard_t * pShard)
+{
+    size_t index = BLOCK_NIL;
+    for (size_t word = 0U; (word < BLOCK_MAP_WORDS) && (BLOCK_NIL == index); word++)
+    {
+        uint32_t bits = ATOMIC_LOAD(&pShard->freeMap[word]);
+        while ((0U != bits) && (BLOCK_NIL == index))
+        {
+            uint32_t bit = bits & (~bits + 1U); /* Lowest set bit */
+            uint32_t old = ATOMIC_FETCH_AND(&pShard->freeMap[word], ~bit);
+            if (0U != (old & bit))
+            {
+                index = (word * BLOCK_MAP_BITS) + BIT_CTZ(bit);
+            }
+            else
+            {
+                /* Bit stolen meanwhile, retry with current word value */
+                bits = old & ~bit;
+            }
+        }
+    }
+    return index;
+}
+
+/**
+ * @brief Steal half of free blocks of a random victim sub-pool, lock-free
+ * 
+ * Upper half of free bits of every victim word is cleared with a single fetch-and,
+ * bits actually cleared now belong to thief and are merged into its map.
+ * 
+ * @param pShard Thief sub-pool
+ * @param home Index of thief sub-pool
+ * @return size_t Number of blocks stolen
+ */
+static size_t subpool_steal(block_shard_t * pShard, size_t home)
+{
+    size_t stolen = 0U;
+#if (BLOCK_SHARDS > 1U)
+    if (0U == blockStealSeed)
+    {
+        blockStealSeed = ((uint32_t)home + 1U) * 2654435761U;
+    }
+    else
+    {
+        /* Already seeded */
+    }
+    /* xorshift32 */
+    blockStealSeed ^= blockStealSeed << 13;
+    blockStealSeed ^= blockStealSeed >> 17;
+    blockStealSeed ^= blockStealSeed << 5;
+    size_t first = (size_t)blockStealSeed % ((size_t)BLOCK_SHARDS - 1U);
+
+    /* Random victim first, then remaining ones so the whole pool stays usable under skew */
+    for (size_t attempt = 0U; (attempt < ((size_t)BLOCK_SHARDS - 1U)) && (0U == stolen); attempt++)
+    {
+        size_t victim = (home + 1U + ((first + attempt) % ((size_t)BLOCK_SHARDS - 1U))) % (size_t)BLOCK_SHARDS;
+        for (size_t word = 0U; word < BLOCK_MAP_WORDS; word++)
+        {
+            uint32_t bits = ATOMIC_LOAD(&blockShards[victim].freeMap[word]);
+            if (0U != bits)
+            {
+                /* Drop lower half of set bits, rounding stolen half up so last block can move */
+                size_t keep = BIT_POPCOUNT(bits) / 2U;
+                for (size_t count = 0U; count < keep; count++)
+                {
+                    bits &= bits - 1U;
+                }
+                uint32_t got = ATOMIC_FETCH_AND(&blockShards[victim].freeMap[word], ~bits) & bits;
+                if (0U != got)
+                {
+                    (void)ATOMIC_FETCH_OR(&pShard->freeMap[word], got);
+                    stolen += BIT_POPCOUNT(got);
+                }
+                else
+                {
+                    /* Taken by victim or other thief meanwhile */
+                }
+            }
+            else
+            {
+                /* Nothing to steal in word */
+            }
+        }
+    }
+#else
+    (void)pShard;
+    (void)home;
+#endif
+    return stolen;
+}
+
+/**
+ * @brief Return block to sub-pool, lock-free
+ * 
+ * @param pShard Sub-pool of freeing thread
+ * @param index Block index
+ * @return true Block was freed
+ * @return false Block was not in use
+ */
+static bool subpool_free(block_shard_t * pShard, size_t index)
+{
+    /* Verify double free before proceeding */
+    bool freed = block_claim(index, BLOCK_UNUSED);
+    if (freed)
+    {
+        /* Block is exclusively ours until it is published in the map */
+        uint8_t * pAddr = &staticPool[index * BLOCK_STRIDE];
+        BLOCK_MEMSET(pAddr, BLOCK_SIZE, 0U);
+        (void)ATOMIC_FETCH_OR(&pShard->freeMap[index / BLOCK_MAP_BITS], (uint32_t)1U << (index % BLOCK_MAP_BITS));
+        (void)ATOMIC_FETCH_SUB(&pShard->numUsed, 1U);
+#if BLOCK_POOL_FD
+        (void)ATOMIC_FETCH_ADD(&blockFreeBlocks, 1U);
+#endif
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return freed;
+}
+#endif
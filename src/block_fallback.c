@@ -0,0 +1,210 @@
+/**
+ * @file block_fallback.c
+ * @author Hrvoje Z
+ * @brief Composable fallback allocator source file
+ * @version 0.1
+ * @date 2025-01-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+/* Includes */
+#include "block_defs.h"
+#include "block.h"
+#include "block_fallback.h"
+
+#ifndef EMBEDDED_TARGET
+#include <stdlib.h>
+#endif
+
+/* Macros and Constants */
+
+/* Type definitions */
+
+/* Static function prototypes */
+static void * pool_alloc(void * pCtx);
+static void pool_free(void * pCtx, void * pBlock);
+static bool pool_owns(void * pCtx, const void * pBlock);
+#ifndef EMBEDDED_TARGET
+static void * heap_alloc(void * pCtx);
+static void heap_free(void * pCtx, void * pBlock);
+#endif
+static void * fallback_alloc(void * pCtx);
+static void fallback_free(void * pCtx, void * pBlock);
+static bool fallback_owns(void * pCtx, const void * pBlock);
+
+/* Public variables */
+
+const block_allocator_t blockPoolAllocator = {
+    .alloc = pool_alloc,
+    .free  = pool_free,
+    .owns  = pool_owns,
+    .pCtx  = NULL,
+};
+
+#ifndef EMBEDDED_TARGET
+const block_allocator_t blockHeapAllocator = {
+    .alloc = heap_alloc,
+    .free  = heap_free,
+    .owns  = NULL, /* Catch-all, heap pointers have no cheap ownership check */
+    .pCtx  = NULL,
+};
+#endif
+
+/* Public functions */
+
+/**
+ * @brief Initialize fallback allocator
+ * 
+ * @param pFallback Fallback allocator to initialize
+ * @param pPrimary Allocator used first, must provide owns()
+ * @param pSecondary Allocator used when primary returns NULL
+ */
+void block_fallback_init(block_fallback_t * pFallback, const block_allocator_t * pPrimary, const block_allocator_t * pSecondary)
+{
+    if ((NULL != pFallback) && (NULL != pPrimary) && (NULL != pSecondary))
+    {
+        pFallback->primary   = *pPrimary;
+        pFallback->secondary = *pSecondary;
+    }
+    else
+    {
+        /* Do nothing */
+    }
+}
+
+/**
+ * @brief Allocate single block from primary, overflow to secondary
+ * 
+ * @param pFallback Fallback allocator
+ * @return void* Pointer to allocated block, NULL if both allocators are exhausted
+ */
+void * block_fallback_alloc(block_fallback_t * pFallback)
+{
+    void * pAddr = pFallback->primary.alloc(pFallback->primary.pCtx);
+    if (NULL == pAddr)
+    {
+        /* Primary exhausted */
+        pAddr = pFallback->secondary.alloc(pFallback->secondary.pCtx);
+    }
+    else
+    {
+        /* Served from primary */
+    }
+    return pAddr;
+}
+
+/**
+ * @brief Free single block to the allocator that owns it
+ * 
+ * Owner is resolved with primary range check only, blocks carry no header.
+ * 
+ * @param pFallback Fallback allocator
+ * @param pBlock Pointer to block
+ */
+void block_fallback_free(block_fallback_t * pFallback, void * pBlock)
+{
+    if (NULL == pBlock)
+    {
+        /* Do nothing */
+    }
+    else if (pFallback->primary.owns(pFallback->primary.pCtx, pBlock))
+    {
+        pFallback->primary.free(pFallback->primary.pCtx, pBlock);
+    }
+    else
+    {
+        pFallback->secondary.free(pFallback->secondary.pCtx, pBlock);
+    }
+}
+
+/**
+ * @brief Check if block belongs to either allocator of the chain
+ * 
+ * @param pFallback Fallback allocator
+ * @param pBlock Pointer to check
+ * @return true Block is owned by primary or secondary (always true for catch-all secondary)
+ * @return false Block is not owned by chain
+ */
+bool block_fallback_owns(block_fallback_t * pFallback, const void * pBlock)
+{
+    bool owned = pFallback->primary.owns(pFallback->primary.pCtx, pBlock);
+    if (!owned)
+    {
+        owned = (NULL == pFallback->secondary.owns) ? (NULL != pBlock)
+                                                    : pFallback->secondary.owns(pFallback->secondary.pCtx, pBlock);
+    }
+    else
+    {
+        /* Owned by primary */
+    }
+    return owned;
+}
+
+/**
+ * @brief Wrap fallback allocator into generic interface so chains can be composed
+ * 
+ * @param pFallback Fallback allocator, must outlive returned interface
+ * @return block_allocator_t Generic allocator interface
+ */
+block_allocator_t block_fallback_allocator(block_fallback_t * pFallback)
+{
+    block_allocator_t allocator = {
+        .alloc = fallback_alloc,
+        .free  = fallback_free,
+        /* Chain ending in catch-all allocator is catch-all itself */
+        .owns  = (NULL == pFallback->secondary.owns) ? NULL : fallback_owns,
+        .pCtx  = pFallback,
+    };
+    return allocator;
+}
+
+/* Static functions */
+
+static void * pool_alloc(void * pCtx)
+{
+    (void)pCtx;
+    return block_alloc();
+}
+
+static void pool_free(void * pCtx, void * pBlock)
+{
+    (void)pCtx;
+    block_free(pBlock);
+}
+
+static bool pool_owns(void * pCtx, const void * pBlock)
+{
+    (void)pCtx;
+    return block_owns(pBlock);
+}
+
+#ifndef EMBEDDED_TARGET
+static void * heap_alloc(void * pCtx)
+{
+    (void)pCtx;
+    return malloc(block_size());
+}
+
+static void heap_free(void * pCtx, void * pBlock)
+{
+    (void)pCtx;
+    free(pBlock);
+}
+#endif
+
+static void * fallback_alloc(void * pCtx)
+{
+    return block_fallback_alloc((block_fallback_t *)pCtx);
+}
+
+static void fallback_free(void * pCtx, void * pBlock)
+{
+    block_fallback_free((block_fallback_t *)pCtx, pBlock);
+}
+
+static bool fallback_owns(void * pCtx, const void * pBlock)
+{
+    return block_fallback_owns((block_fallback_t *)pCtx, pBlock);
+}
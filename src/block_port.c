@@ -0,0 +1,103 @@
+/**
+ * @file block_port.c
+ * @author Hrvoje Z
+ * @brief Embedded port layer source file
+ * @version 0.1
+ * @date 2025-01-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+/* Includes */
+#include "block_defs.h"
+
+#ifdef EMBEDDED_TARGET
+#if (BLOCK_PORT == BLOCK_PORT_POSIX)
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+/* Public variables */
+
+#ifdef PORT_CRITICAL_GENERIC
+PORT_CPU_LOCAL port_irq_t portLockIrq; /* Interrupt state of lock held by current core */
+#endif
+
+#if (BLOCK_PORT == BLOCK_PORT_POSIX)
+/* Static variables */
+static atomic_flag portBusLock = ATOMIC_FLAG_INIT; /* Serializes atomic sections of simulated cores */
+static _Thread_local uint32_t portIrqDepth = 0U;   /* Nesting of masked sections, mask syscall on outermost only */
+
+/* Public functions */
+
+/**
+ * @brief Block all signals of calling thread, simulated interrupt disable
+ * 
+ * Atomic sections nest inside lock critical sections, where signals are
+ * already blocked, so only outermost section pays for the mask syscall.
+ * 
+ * @return port_irq_t Previous signal mask
+ */
+port_irq_t port_posix_irq_save(void)
+{
+    port_irq_t previous;
+    if (0U == portIrqDepth)
+    {
+        sigset_t all;
+        sigfillset(&all);
+        (void)pthread_sigmask(SIG_BLOCK, &all, &previous);
+    }
+    else
+    {
+        sigemptyset(&previous); /* Nested, restored by outermost section */
+    }
+    portIrqDepth++;
+    return previous;
+}
+
+/**
+ * @brief Restore signal mask of calling thread, simulated interrupt restore
+ * 
+ * @param state Signal mask returned by port_posix_irq_save()
+ */
+void port_posix_irq_restore(port_irq_t state)
+{
+    portIrqDepth--;
+    if (0U == portIrqDepth)
+    {
+        (void)pthread_sigmask(SIG_SETMASK, &state, NULL);
+    }
+    else
+    {
+        /* Nested, signals stay blocked */
+    }
+}
+
+/**
+ * @brief Enter atomic section, signals blocked and other threads excluded
+ * 
+ * @return port_irq_t Previous signal mask
+ */
+port_irq_t port_posix_bus_lock(void)
+{
+    port_irq_t state = port_posix_irq_save();
+    while (atomic_flag_test_and_set_explicit(&portBusLock, memory_order_acquire))
+    {
+        /* Held by other thread, which can not be interrupted while holding it */
+    }
+    return state;
+}
+
+/**
+ * @brief Leave atomic section
+ * 
+ * @param state Signal mask returned by port_posix_bus_lock()
+ */
+void port_posix_bus_unlock(port_irq_t state)
+{
+    atomic_flag_clear_explicit(&portBusLock, memory_order_release);
+    port_posix_irq_restore(state);
+}
+#endif
+#endif
@@ -0,0 +1,1053 @@
+/**
+ * @file block_shm.c
+ * @author Hrvoje Z
+ * @brief Shared memory block pool source file
+ * @version 0.1
+ * @date 2025-01-20
+ * 
+ * @copyright Copyright (c) 2025
+ * 
+ */
+
+/* Includes */
+#include "block_defs.h"
+#include "block_shm.h"
+
+#ifndef EMBEDDED_TARGET
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* Macros and Constants */
+
+#define SHM_MAGIC   (0x4B4C4253U) /* "SBLK" */
+#define SHM_VERSION (1U)
+
+#define CKPT_MAGIC   (0x54504B43U) /* "CKPT" */
+#define CKPT_VERSION (1U)
+
+#define SHM_MAP_BITS  (32U)
+#define SHM_ALIGN     (64U) /* Occupancy map and blocks start on cache line */
+
+/**
+ * @brief Number of 32 bit words needed for given number of bits
+ */
+#define SHM_WORDS(bits) \
+    (((bits) + SHM_MAP_BITS - 1U) / SHM_MAP_BITS)
+
+/**
+ * @brief Round size up to multiple of alignment
+ */
+#define SHM_ROUND_UP(size, align) \
+    ((((size) + (align) - 1U) / (align)) * (align))
+
+/**
+ * @brief Mask of bits in occupancy map word that belong to blocks of pool
+ */
+#define SHM_WORD_MASK(numBlocks, word) \
+    ((((numBlocks) - ((word) * SHM_MAP_BITS)) >= SHM_MAP_BITS) ? UINT32_MAX : \
+     (((uint32_t)1U << ((numBlocks) - ((word) * SHM_MAP_BITS))) - 1U))
+
+/* Type definitions */
+
+/**
+ * @brief Pool header at start of shared mapping, same layout in every process
+ * 
+ * Only fixed width fields, mapping may be shared by 32 and 64 bit processes.
+ */
+typedef struct
+{
+    uint32_t magic;       /* SHM_MAGIC once header is initialized */
+    uint32_t version;     /* Layout version */
+    uint64_t blockSize;   /* Size of single block in bytes */
+    uint64_t numBlocks;   /* Number of blocks in pool */
+    uint64_t mapWords;    /* Words of occupancy map */
+    uint64_t sumWords;    /* Words of summary map */
+    uint64_t sumOffset;   /* Offset of summary map from start of mapping */
+    uint64_t mapOffset;   /* Offset of occupancy map from start of mapping */
+    uint64_t dirtyOffset; /* Offset of dirty map from start of mapping */
+    uint64_t poolOffset;  /* Offset of first block from start of mapping */
+    uint64_t size;        /* Size of whole mapping */
+    ATOMIC uint32_t attached; /* Processes attached through handle */
+    ATOMIC uint32_t clean;    /* Last process detached properly, summary can be trusted */
+    CACHE_ALIGNED ATOMIC uint32_t cursor; /* Summary word to search first, allocation hint */
+} shm_header_t;
+
+/**
+ * @brief Offsets of mapping parts
+ */
+typedef struct
+{
+    size_t sumOffset;   /* Summary map */
+    size_t mapOffset;   /* Occupancy map */
+    size_t dirtyOffset; /* Dirty map */
+    size_t poolOffset;  /* First block */
+    size_t size;        /* Whole mapping */
+} shm_layout_t;
+
+/**
+ * @brief Checkpoint header, followed by occupancy map and records of live blocks
+ * 
+ * Each record is uint32_t block index followed by block contents, records end
+ * with BLOCK_SHM_NIL index.
+ */
+typedef struct
+{
+    uint32_t magic;     /* CKPT_MAGIC */
+    uint32_t version;   /* Stream format version */
+    uint64_t blockSize; /* Size of single block in bytes */
+    uint64_t numBlocks; /* Number of blocks in pool */
+    uint32_t full;      /* All live blocks follow, otherwise only dirty ones */
+    uint32_t reserved;  /* Padding, zero */
+} shm_ckpt_header_t;
+
+/**
+ * @brief Process local handle, addresses differ between processes
+ */
+struct block_shm
+{
+    shm_header_t * pHeader;       /* Start of mapping */
+    ATOMIC uint32_t * pSummary;   /* Summary map, set bit means map word may have free blocks */
+    ATOMIC uint32_t * pFreeMap;   /* Occupancy map, set bit means free block */
+    ATOMIC uint32_t * pDirty;     /* Dirty map, set bit means block modified since checkpoint */
+    uint8_t * pPool;              /* First block */
+    int fd;                       /* Descriptor of shared memory object */
+    bool recovered;               /* Summary was rebuilt on attach */
+};
+
+/* Static function prototypes */
+static block_shm_t * shm_map(int fd, bool init, size_t blockSize, size_t numBlocks);
+static void shm_layout(size_t blockSize, size_t numBlocks, shm_layout_t * pLayout);
+static uint32_t shm_take(block_shm_t * pShm, size_t word);
+static void shm_summary_clear(block_shm_t * pShm, size_t word);
+static void shm_rebuild(block_shm_t * pShm);
+static bool shm_write_all(int fd, const void * pData, size_t size);
+static size_t shm_read_all(int fd, void * pData, size_t size);
+static bool shm_file_lock(int fd, short type, bool wait);
+
+/* Public functions */
+
+/**
+ * @brief Create shared memory pool
+ * 
+ * @param pName POSIX shared memory name (e.g. "/pool"), NULL for anonymous memfd
+ * @param blockSize Size of single block in bytes, multiple of 4
+ * @param numBlocks Number of blocks in pool
+ * @return block_shm_t* Pool handle, NULL on invalid size or if object could not be created
+ */
+block_shm_t * block_shm_create(const char * pName, size_t blockSize, size_t numBlocks)
+{
+    block_shm_t * pShm = NULL;
+    int fd = -1;
+    if ((0U < blockSize) && (0U == (blockSize % 4U)) && (0U < numBlocks) && (numBlocks < (size_t)BLOCK_SHM_NIL))
+    {
+        if (NULL == pName)
+        {
+#ifdef __linux__
+            fd = memfd_create("block_shm", MFD_CLOEXEC);
+#else
+            /* No memfd, use named object and drop name right away */
+            fd = shm_open("/block_shm_anon", O_RDWR | O_CREAT | O_EXCL, 0600);
+            (void)shm_unlink("/block_shm_anon");
+#endif
+        }
+        else
+        {
+            fd = shm_open(pName, O_RDWR | O_CREAT | O_EXCL, 0600);
+        }
+    }
+    else
+    {
+        /* Invalid pool size */
+    }
+
+    if (0 <= fd)
+    {
+        pShm = shm_map(fd, true, blockSize, numBlocks);
+        if (NULL == pShm)
+        {
+            (void)close(fd);
+            if (NULL != pName)
+            {
+                (void)shm_unlink(pName);
+            }
+            else
+            {
+                /* Anonymous object goes away with descriptor */
+            }
+        }
+        else
+        {
+            /* Do nothing */
+        }
+    }
+    else
+    {
+        /* Creation failed */
+    }
+    return pShm;
+}
+
+/**
+ * @brief Attach to named shared memory pool created by other process
+ * 
+ * @param pName POSIX shared memory name
+ * @return block_shm_t* Pool handle, NULL if object does not exist or is not a pool
+ */
+block_shm_t * block_shm_open(const char * pName)
+{
+    block_shm_t * pShm = NULL;
+    int fd = (NULL != pName) ? shm_open(pName, O_RDWR, 0600) : -1;
+    if (0 <= fd)
+    {
+        pShm = shm_map(fd, false, 0U, 0U);
+        if (NULL == pShm)
+        {
+            (void)close(fd);
+        }
+        else
+        {
+            /* Do nothing */
+        }
+    }
+    else
+    {
+        /* Open failed */
+    }
+    return pShm;
+}
+
+/**
+ * @brief Attach to pool through descriptor received from other process (fork, SCM_RIGHTS)
+ * 
+ * @param fd Descriptor of pool, duplicated so caller keeps ownership
+ * @return block_shm_t* Pool handle, NULL if descriptor is not a pool
+ */
+block_shm_t * block_shm_attach(int fd)
+{
+    block_shm_t * pShm = NULL;
+    int dupFd = (0 <= fd) ? fcntl(fd, F_DUPFD_CLOEXEC, 0) : -1;
+    if (0 <= dupFd)
+    {
+        pShm = shm_map(dupFd, false, 0U, 0U);
+        if (NULL == pShm)
+        {
+            (void)close(dupFd);
+        }
+        else
+        {
+            /* Do nothing */
+        }
+    }
+    else
+    {
+        /* Invalid descriptor */
+    }
+    return pShm;
+}
+
+/**
+ * @brief Map pool placed in a file, allocated blocks survive restart
+ * 
+ * New or empty file is sized and initialized. Existing pool is re-attached with
+ * blocks allocated before, the summary map is rebuilt from the occupancy bitmap
+ * unless the last process detached properly.
+ * 
+ * @param pPath File path
+ * @param blockSize Size of single block in bytes, 0 accepts size of existing pool
+ * @param numBlocks Number of blocks in pool, 0 accepts number of existing pool
+ * @return block_shm_t* Pool handle, NULL on failure or if existing pool has other geometry
+ */
+block_shm_t * block_shm_map_file(const char * pPath, size_t blockSize, size_t numBlocks)
+{
+    block_shm_t * pShm = NULL;
+    struct stat st;
+    int fd = (NULL != pPath) ? open(pPath, O_RDWR | O_CREAT | O_CLOEXEC, 0600) : -1;
+    /* Attached processes hold read lock on file, write lock is granted only when no other process holds it */
+    bool alone = (0 <= fd) && shm_file_lock(fd, F_WRLCK, false);
+    if ((0 <= fd) && !alone)
+    {
+        (void)shm_file_lock(fd, F_RDLCK, true);
+    }
+    else
+    {
+        /* Alone with file or open failed */
+    }
+    if ((0 <= fd) && (0 == fstat(fd, &st)))
+    {
+        if (0 == st.st_size)
+        {
+            bool valid = (0U < blockSize) && (0U == (blockSize % 4U)) && (0U < numBlocks) && (numBlocks < (size_t)BLOCK_SHM_NIL);
+            pShm = valid ? shm_map(fd, true, blockSize, numBlocks) : NULL;
+        }
+        else
+        {
+            pShm = shm_map(fd, false, 0U, 0U);
+            if ((NULL != pShm) &&
+                (((0U != blockSize) && ((uint64_t)blockSize != pShm->pHeader->blockSize)) ||
+                 ((0U != numBlocks) && ((uint64_t)numBlocks != pShm->pHeader->numBlocks))))
+            {
+                /* Geometry mismatch, fd is released with handle */
+                block_shm_detach(pShm);
+                pShm = NULL;
+                fd = -1;
+            }
+            else if (NULL != pShm)
+            {
+                /* Live processes keep flag cleared, it tells a crash only when nobody else holds the file */
+                bool wasClean = (0U != ATOMIC_XCHG(&pShm->pHeader->clean, 0U));
+                if (alone && !wasClean)
+                {
+                    /* Attach counts of processes that died without detaching are dropped */
+                    ATOMIC_STORE(&pShm->pHeader->attached, 1U);
+                    /* Previous user did not detach, occupancy bitmap is the only source of truth */
+                    shm_rebuild(pShm);
+                    pShm->recovered = true;
+                }
+                else if (alone)
+                {
+                    /* Clean shutdown, nothing to rebuild */
+                }
+                else
+                {
+                    /* Attached to pool in use by live processes, flag is theirs */
+                }
+            }
+            else
+            {
+                /* Not a pool */
+            }
+        }
+    }
+    else
+    {
+        /* Open failed */
+    }
+
+    if ((NULL == pShm) && (0 <= fd))
+    {
+        (void)close(fd);
+    }
+    else if ((NULL != pShm) && alone)
+    {
+        /* Downgrade is atomic, other processes may attach from now on */
+        (void)shm_file_lock(fd, F_RDLCK, false);
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return pShm;
+}
+
+/**
+ * @brief Check whether summary map had to be rebuilt when pool file was mapped
+ * 
+ * @param pShm Pool handle
+ * @return true Pool was not detached properly before, summary was rebuilt
+ * @return false Clean re-attach, new pool or shared memory pool
+ */
+bool block_shm_recovered(const block_shm_t * pShm)
+{
+    return (NULL != pShm) && pShm->recovered;
+}
+
+/**
+ * @brief Unmap pool from calling process, pool lives on while other processes are attached
+ * 
+ * Blocks still allocated stay allocated, named objects must be removed with shm_unlink().
+ * 
+ * @param pShm Pool handle
+ */
+void block_shm_detach(block_shm_t * pShm)
+{
+    if (NULL != pShm)
+    {
+        if (1U == ATOMIC_FETCH_SUB(&pShm->pHeader->attached, 1U))
+        {
+            /* Last process, persist blocks and bitmaps before marking shutdown clean */
+            (void)msync(pShm->pHeader, (size_t)pShm->pHeader->size, MS_SYNC);
+            ATOMIC_STORE(&pShm->pHeader->clean, 1U);
+            (void)msync(pShm->pHeader, SHM_ALIGN, MS_SYNC);
+        }
+        else
+        {
+            /* Other processes still attached */
+        }
+        (void)munmap(pShm->pHeader, (size_t)pShm->pHeader->size);
+        (void)close(pShm->fd);
+        free(pShm);
+    }
+    else
+    {
+        /* Do nothing */
+    }
+}
+
+/**
+ * @brief Get descriptor of pool, to be passed to other processes
+ * 
+ * @param pShm Pool handle
+ * @return int Descriptor, -1 for invalid handle
+ */
+int block_shm_fd(const block_shm_t * pShm)
+{
+    return (NULL != pShm) ? pShm->fd : -1;
+}
+
+/**
+ * @brief Allocate single block, lock-free
+ * 
+ * A block is taken with a single atomic operation, process dying at any point
+ * can not leave the pool locked or inconsistent.
+ * 
+ * @param pShm Pool handle
+ * @return uint32_t Block index, BLOCK_SHM_NIL if pool is exhausted
+ */
+uint32_t block_shm_alloc(block_shm_t * pShm)
+{
+    uint32_t index = BLOCK_SHM_NIL;
+    if (NULL != pShm)
+    {
+        size_t sumWords = (size_t)pShm->pHeader->sumWords;
+        size_t start = (size_t)ATOMIC_LOAD(&pShm->pHeader->cursor) % sumWords;
+        /* Summary points to map words with free blocks, start at hint so processes spread out */
+        for (size_t step = 0U; (step < sumWords) && (BLOCK_SHM_NIL == index); step++)
+        {
+            size_t sumWord = (start + step) % sumWords;
+            uint32_t sumBits = ATOMIC_LOAD(&pShm->pSummary[sumWord]);
+            while ((0U != sumBits) && (BLOCK_SHM_NIL == index))
+            {
+                size_t bit = BIT_CTZ(sumBits);
+                index = shm_take(pShm, (sumWord * SHM_MAP_BITS) + bit);
+                sumBits &= ~((uint32_t)1U << bit);
+            }
+            if ((BLOCK_SHM_NIL != index) && (sumWord != start))
+            {
+                ATOMIC_STORE(&pShm->pHeader->cursor, (uint32_t)sumWord);
+            }
+            else
+            {
+                /* Hint still valid or nothing found */
+            }
+        }
+        /* Summary is a hint, do not report exhaustion before whole bitmap was checked */
+        for (size_t word = 0U; (word < (size_t)pShm->pHeader->mapWords) && (BLOCK_SHM_NIL == index); word++)
+        {
+            index = shm_take(pShm, word);
+        }
+        if (BLOCK_SHM_NIL != index)
+        {
+            /* Contents left by previous owner must not survive restore */
+            block_shm_mark_dirty(pShm, index);
+        }
+        else
+        {
+            /* Pool exhausted */
+        }
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return index;
+}
+
+/**
+ * @brief Free single block, lock-free, may be called from any attached process
+ * 
+ * @param pShm Pool handle
+ * @param index Block index
+ * @return true Block was freed
+ * @return false Invalid index or block was not in use (double free)
+ */
+bool block_shm_free(block_shm_t * pShm, uint32_t index)
+{
+    bool freed = false;
+    if ((NULL != pShm) && ((uint64_t)index < pShm->pHeader->numBlocks))
+    {
+        uint32_t mask = (uint32_t)1U << (index % SHM_MAP_BITS);
+        size_t word = index / SHM_MAP_BITS;
+        uint32_t prev = ATOMIC_FETCH_OR(&pShm->pFreeMap[word], mask);
+        freed = (0U == (prev & mask));
+        if (0U == prev)
+        {
+            /* Word was full, make it visible in summary */
+            (void)ATOMIC_FETCH_OR(&pShm->pSummary[word / SHM_MAP_BITS], (uint32_t)1U << (word % SHM_MAP_BITS));
+        }
+        else
+        {
+            /* Summary bit already set */
+        }
+    }
+    else
+    {
+        /* Invalid index */
+    }
+    return freed;
+}
+
+/**
+ * @brief Mark block as modified, it is written by next incremental checkpoint
+ * 
+ * Newly allocated blocks are marked by allocation.
+ * 
+ * @param pShm Pool handle
+ * @param index Block index
+ */
+void block_shm_mark_dirty(block_shm_t * pShm, uint32_t index)
+{
+    if ((NULL != pShm) && ((uint64_t)index < pShm->pHeader->numBlocks))
+    {
+        (void)ATOMIC_FETCH_OR(&pShm->pDirty[index / SHM_MAP_BITS], (uint32_t)1U << (index % SHM_MAP_BITS));
+    }
+    else
+    {
+        /* Invalid index */
+    }
+}
+
+/**
+ * @brief Stream checkpoint of pool to file descriptor
+ * 
+ * Occupancy map is always written, followed by all live blocks (full) or only
+ * live blocks marked dirty since previous checkpoint (incremental). Dirty bits
+ * are cleared before block is copied, so writes racing with checkpoint are
+ * picked up by next one.
+ * 
+ * @param pShm Pool handle
+ * @param fd File descriptor to write to, e.g. file or socket
+ * @param full Write all live blocks, used for base snapshot
+ * @return true Checkpoint written
+ * @return false Invalid handle, out of memory or write failed
+ */
+bool block_shm_checkpoint(block_shm_t * pShm, int fd, bool full)
+{
+    bool ok = false;
+    size_t words = (NULL != pShm) ? (size_t)pShm->pHeader->mapWords : 0U;
+    uint32_t * pMap = (0U < words) ? malloc(words * sizeof(uint32_t)) : NULL;
+    if (NULL != pMap)
+    {
+        size_t numBlocks = (size_t)pShm->pHeader->numBlocks;
+        size_t blockSize = (size_t)pShm->pHeader->blockSize;
+        uint32_t end = BLOCK_SHM_NIL;
+        shm_ckpt_header_t header = {
+            .magic     = CKPT_MAGIC,
+            .version   = CKPT_VERSION,
+            .blockSize = (uint64_t)blockSize,
+            .numBlocks = (uint64_t)numBlocks,
+            .full      = full ? 1U : 0U,
+            .reserved  = 0U,
+        };
+        /* Snapshot map once, records follow exactly the map that was written */
+        for (size_t word = 0U; word < words; word++)
+        {
+            pMap[word] = ATOMIC_LOAD(&pShm->pFreeMap[word]);
+        }
+        ok = shm_write_all(fd, &header, sizeof(header)) && shm_write_all(fd, pMap, words * sizeof(uint32_t));
+        for (size_t word = 0U; ok && (word < words); word++)
+        {
+            uint32_t live = ~pMap[word] & SHM_WORD_MASK(numBlocks, word);
+            /* Clear only bits captured now, blocks allocated after snapshot stay dirty */
+            uint32_t dirty = ATOMIC_FETCH_AND(&pShm->pDirty[word], ~live);
+            uint32_t captured = full ? live : (dirty & live);
+            while (ok && (0U != captured))
+            {
+                uint32_t index = (uint32_t)((word * SHM_MAP_BITS) + BIT_CTZ(captured));
+                struct iovec iov[2] = {
+                    { .iov_base = &index, .iov_len = sizeof(index) },
+                    { .iov_base = &pShm->pPool[(size_t)index * blockSize], .iov_len = blockSize },
+                };
+                ssize_t written = writev(fd, iov, 2);
+                if ((0 <= written) && ((size_t)written < sizeof(index)))
+                {
+                    /* Short write inside index, finish record piece by piece */
+                    ok = shm_write_all(fd, (uint8_t *)&index + written, sizeof(index) - (size_t)written) &&
+                         shm_write_all(fd, iov[1].iov_base, blockSize);
+                }
+                else if (0 <= written)
+                {
+                    ok = shm_write_all(fd, (uint8_t *)iov[1].iov_base + ((size_t)written - sizeof(index)),
+                                       blockSize - ((size_t)written - sizeof(index)));
+                }
+                else
+                {
+                    ok = false;
+                }
+                captured &= captured - 1U;
+            }
+        }
+        ok = ok && shm_write_all(fd, &end, sizeof(end));
+        free(pMap);
+    }
+    else
+    {
+        /* Invalid handle or out of memory */
+    }
+    return ok;
+}
+
+/**
+ * @brief Restore pool from checkpoints read from file descriptor until end of file
+ * 
+ * Base snapshot followed by incremental checkpoints in order, either
+ * concatenated or passed in separate calls. Pool must have same geometry and
+ * must not be used by other processes during restore.
+ * 
+ * @param pShm Pool handle
+ * @param fd File descriptor to read from
+ * @return true At least one checkpoint applied
+ * @return false Invalid handle, geometry mismatch, corrupted or truncated stream
+ */
+bool block_shm_restore(block_shm_t * pShm, int fd)
+{
+    bool ok = false;
+    size_t words = (NULL != pShm) ? (size_t)pShm->pHeader->mapWords : 0U;
+    uint32_t * pMap = (0U < words) ? malloc(words * sizeof(uint32_t)) : NULL;
+    if (NULL != pMap)
+    {
+        size_t numBlocks = (size_t)pShm->pHeader->numBlocks;
+        size_t blockSize = (size_t)pShm->pHeader->blockSize;
+        size_t applied = 0U;
+        bool more = true;
+        ok = true;
+        while (ok && more)
+        {
+            shm_ckpt_header_t header;
+            size_t got = shm_read_all(fd, &header, sizeof(header));
+            if (0U == got)
+            {
+                /* End of stream */
+                more = false;
+            }
+            else
+            {
+                uint32_t index = BLOCK_SHM_NIL;
+                ok = (sizeof(header) == got) && (CKPT_MAGIC == header.magic) && (CKPT_VERSION == header.version) &&
+                     ((uint64_t)blockSize == header.blockSize) && ((uint64_t)numBlocks == header.numBlocks) &&
+                     ((words * sizeof(uint32_t)) == shm_read_all(fd, pMap, words * sizeof(uint32_t)));
+                for (size_t word = 0U; ok && (word < words); word++)
+                {
+                    ATOMIC_STORE(&pShm->pFreeMap[word], pMap[word] & SHM_WORD_MASK(numBlocks, word));
+                }
+                ok = ok && (sizeof(index) == shm_read_all(fd, &index, sizeof(index)));
+                while (ok && (BLOCK_SHM_NIL != index))
+                {
+                    ok = ((size_t)index < numBlocks) &&
+                         (blockSize == shm_read_all(fd, &pShm->pPool[(size_t)index * blockSize], blockSize)) &&
+                         (sizeof(index) == shm_read_all(fd, &index, sizeof(index)));
+                }
+                applied++;
+            }
+        }
+        ok = ok && (0U < applied);
+        /* Summary exactly follows restored map, nothing is dirty against restored state */
+        for (size_t word = 0U; word < words; word++)
+        {
+            ATOMIC_STORE(&pShm->pDirty[word], 0U);
+        }
+        for (size_t word = 0U; word < (size_t)pShm->pHeader->sumWords; word++)
+        {
+            ATOMIC_STORE(&pShm->pSummary[word], 0U);
+        }
+        shm_rebuild(pShm);
+        free(pMap);
+    }
+    else
+    {
+        /* Invalid handle or out of memory */
+    }
+    return ok;
+}
+
+/**
+ * @brief Map block index to address in calling process
+ * 
+ * @param pShm Pool handle
+ * @param index Block index
+ * @return void* Start of block, NULL for invalid index
+ */
+void * block_shm_ptr(const block_shm_t * pShm, uint32_t index)
+{
+    uint8_t * pAddr = NULL;
+    if ((NULL != pShm) && ((uint64_t)index < pShm->pHeader->numBlocks))
+    {
+        pAddr = &pShm->pPool[(size_t)index * (size_t)pShm->pHeader->blockSize];
+    }
+    else
+    {
+        /* Invalid index */
+    }
+    return pAddr;
+}
+
+/**
+ * @brief Map pointer inside a block to block index
+ * 
+ * @param pShm Pool handle
+ * @param pBlock Pointer to any byte of a block
+ * @return uint32_t Block index, BLOCK_SHM_NIL if pointer is not inside pool
+ */
+uint32_t block_shm_index_of(const block_shm_t * pShm, const void * pBlock)
+{
+    uint32_t index = BLOCK_SHM_NIL;
+    if (NULL != pShm)
+    {
+        size_t poolSize = (size_t)pShm->pHeader->numBlocks * (size_t)pShm->pHeader->blockSize;
+        if (((uintptr_t)pBlock >= (uintptr_t)pShm->pPool) && ((uintptr_t)pBlock < ((uintptr_t)pShm->pPool + poolSize)))
+        {
+            index = (uint32_t)(((uintptr_t)pBlock - (uintptr_t)pShm->pPool) / (size_t)pShm->pHeader->blockSize);
+        }
+        else
+        {
+            /* Not owned by pool */
+        }
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return index;
+}
+
+/**
+ * @brief Get size of single block
+ * 
+ * @param pShm Pool handle
+ * @return size_t Block size in bytes, 0 for invalid handle
+ */
+size_t block_shm_block_size(const block_shm_t * pShm)
+{
+    return (NULL != pShm) ? (size_t)pShm->pHeader->blockSize : 0U;
+}
+
+/**
+ * @brief Get number of blocks in pool
+ * 
+ * @param pShm Pool handle
+ * @return size_t Number of blocks, 0 for invalid handle
+ */
+size_t block_shm_num_blocks(const block_shm_t * pShm)
+{
+    return (NULL != pShm) ? (size_t)pShm->pHeader->numBlocks : 0U;
+}
+
+/* Static functions */
+
+/**
+ * @brief Compute layout of mapping
+ * 
+ * @param blockSize Size of single block in bytes
+ * @param numBlocks Number of blocks in pool
+ * @param pLayout Layout output
+ */
+static void shm_layout(size_t blockSize, size_t numBlocks, shm_layout_t * pLayout)
+{
+    size_t mapWords = SHM_WORDS(numBlocks);
+    pLayout->sumOffset   = SHM_ROUND_UP(sizeof(shm_header_t), SHM_ALIGN);
+    pLayout->mapOffset   = SHM_ROUND_UP(pLayout->sumOffset + (SHM_WORDS(mapWords) * sizeof(uint32_t)), SHM_ALIGN);
+    pLayout->dirtyOffset = SHM_ROUND_UP(pLayout->mapOffset + (mapWords * sizeof(uint32_t)), SHM_ALIGN);
+    pLayout->poolOffset  = SHM_ROUND_UP(pLayout->dirtyOffset + (mapWords * sizeof(uint32_t)), SHM_ALIGN);
+    pLayout->size        = pLayout->poolOffset + (blockSize * numBlocks);
+}
+
+/**
+ * @brief Take free block from occupancy map word
+ * 
+ * @param pShm Pool handle
+ * @param word Occupancy map word
+ * @return uint32_t Block index, BLOCK_SHM_NIL if word has no free blocks
+ */
+static uint32_t shm_take(block_shm_t * pShm, size_t word)
+{
+    uint32_t index = BLOCK_SHM_NIL;
+    uint32_t bits = ATOMIC_LOAD(&pShm->pFreeMap[word]);
+    while ((0U != bits) && (BLOCK_SHM_NIL == index))
+    {
+        uint32_t mask = (uint32_t)1U << BIT_CTZ(bits);
+        uint32_t prev = ATOMIC_FETCH_AND(&pShm->pFreeMap[word], ~mask);
+        if (0U != (prev & mask))
+        {
+            index = (uint32_t)((word * SHM_MAP_BITS) + BIT_CTZ(mask));
+        }
+        else
+        {
+            /* Taken by other process, continue with bits still free */
+        }
+        bits = prev & ~mask;
+    }
+    if (0U == bits)
+    {
+        /* Word is full now */
+        shm_summary_clear(pShm, word);
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return index;
+}
+
+/**
+ * @brief Clear summary bit of full map word
+ * 
+ * Block freed meanwhile may have found the summary bit still set, map word is
+ * checked once more so the bit is not lost.
+ * 
+ * @param pShm Pool handle
+ * @param word Occupancy map word
+ */
+static void shm_summary_clear(block_shm_t * pShm, size_t word)
+{
+    uint32_t mask = (uint32_t)1U << (word % SHM_MAP_BITS);
+    if (0U != (ATOMIC_FETCH_AND(&pShm->pSummary[word / SHM_MAP_BITS], ~mask) & mask))
+    {
+        if (0U != ATOMIC_LOAD(&pShm->pFreeMap[word]))
+        {
+            (void)ATOMIC_FETCH_OR(&pShm->pSummary[word / SHM_MAP_BITS], mask);
+        }
+        else
+        {
+            /* Still full */
+        }
+    }
+    else
+    {
+        /* Already cleared */
+    }
+}
+
+/**
+ * @brief Rebuild summary map from occupancy bitmap, one pass over bitmap words
+ * 
+ * Bits are only set, so processes already attached are not disturbed.
+ * 
+ * @param pShm Pool handle
+ */
+static void shm_rebuild(block_shm_t * pShm)
+{
+    for (size_t word = 0U; word < (size_t)pShm->pHeader->mapWords; word++)
+    {
+        if (0U != ATOMIC_LOAD(&pShm->pFreeMap[word]))
+        {
+            (void)ATOMIC_FETCH_OR(&pShm->pSummary[word / SHM_MAP_BITS], (uint32_t)1U << (word % SHM_MAP_BITS));
+        }
+        else
+        {
+            /* No free blocks */
+        }
+    }
+    ATOMIC_STORE(&pShm->pHeader->cursor, 0U);
+}
+
+/**
+ * @brief Map shared memory object and create process local handle
+ * 
+ * @param fd Descriptor of object, owned by handle on success
+ * @param init Size object and initialize header, otherwise validate existing header
+ * @param blockSize Size of single block in bytes, used with init only
+ * @param numBlocks Number of blocks in pool, used with init only
+ * @return block_shm_t* Pool handle, NULL on failure
+ */
+static block_shm_t * shm_map(int fd, bool init, size_t blockSize, size_t numBlocks)
+{
+    block_shm_t * pShm = NULL;
+    shm_header_t * pHeader = MAP_FAILED;
+    shm_layout_t layout;
+    struct stat st;
+    size_t size = 0U;
+
+    if (init)
+    {
+        shm_layout(blockSize, numBlocks, &layout);
+        size = layout.size;
+        if (0 == ftruncate(fd, (off_t)size))
+        {
+            pHeader = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        else
+        {
+            /* Sizing failed */
+        }
+    }
+    else if ((0 == fstat(fd, &st)) && ((size_t)st.st_size >= sizeof(shm_header_t)))
+    {
+        size = (size_t)st.st_size;
+        pHeader = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    else
+    {
+        /* Not a pool */
+    }
+
+    if (MAP_FAILED != pHeader)
+    {
+        if (init)
+        {
+            /* Fresh object is zero filled, all blocks set free, padding bits stay used */
+            pHeader->version     = SHM_VERSION;
+            pHeader->blockSize   = (uint64_t)blockSize;
+            pHeader->numBlocks   = (uint64_t)numBlocks;
+            pHeader->mapWords    = (uint64_t)SHM_WORDS(numBlocks);
+            pHeader->sumWords    = (uint64_t)SHM_WORDS(SHM_WORDS(numBlocks));
+            pHeader->sumOffset   = (uint64_t)layout.sumOffset;
+            pHeader->mapOffset   = (uint64_t)layout.mapOffset;
+            pHeader->dirtyOffset = (uint64_t)layout.dirtyOffset;
+            pHeader->poolOffset  = (uint64_t)layout.poolOffset;
+            pHeader->size        = (uint64_t)size;
+            for (size_t word = 0U; word < (size_t)pHeader->mapWords; word++)
+            {
+                ATOMIC_STORE(&((ATOMIC uint32_t *)((uint8_t *)pHeader + layout.mapOffset))[word], SHM_WORD_MASK(numBlocks, word));
+            }
+            for (size_t word = 0U; word < (size_t)pHeader->sumWords; word++)
+            {
+                ATOMIC_STORE(&((ATOMIC uint32_t *)((uint8_t *)pHeader + layout.sumOffset))[word], SHM_WORD_MASK((size_t)pHeader->mapWords, word));
+            }
+            ATOMIC_STORE(&pHeader->cursor, 0U);
+            ATOMIC_STORE(&pHeader->clean, 0U);
+            ATOMIC_STORE(&pHeader->attached, 1U);
+            /* Publish header last, attaching processes check magic first */
+            atomic_thread_fence(memory_order_release);
+            pHeader->magic = SHM_MAGIC;
+        }
+        else
+        {
+            bool valid = (SHM_MAGIC == pHeader->magic) && (SHM_VERSION == pHeader->version) &&
+                         (0U < pHeader->numBlocks) && (pHeader->size == (uint64_t)size);
+            atomic_thread_fence(memory_order_acquire);
+            if (valid)
+            {
+                shm_layout((size_t)pHeader->blockSize, (size_t)pHeader->numBlocks, &layout);
+                valid = ((uint64_t)layout.size == pHeader->size) &&
+                        ((uint64_t)layout.sumOffset == pHeader->sumOffset) &&
+                        ((uint64_t)layout.mapOffset == pHeader->mapOffset) &&
+                        ((uint64_t)layout.dirtyOffset == pHeader->dirtyOffset) &&
+                        ((uint64_t)layout.poolOffset == pHeader->poolOffset) &&
+                        ((uint64_t)SHM_WORDS((size_t)pHeader->numBlocks) == pHeader->mapWords) &&
+                        ((uint64_t)SHM_WORDS(SHM_WORDS((size_t)pHeader->numBlocks)) == pHeader->sumWords);
+            }
+            else
+            {
+                /* Not a pool */
+            }
+            if (valid)
+            {
+                (void)ATOMIC_FETCH_ADD(&pHeader->attached, 1U);
+            }
+            else
+            {
+                (void)munmap(pHeader, size);
+                pHeader = MAP_FAILED;
+            }
+        }
+    }
+    else
+    {
+        /* Mapping failed */
+    }
+
+    if (MAP_FAILED != pHeader)
+    {
+        pShm = malloc(sizeof(block_shm_t));
+        if (NULL != pShm)
+        {
+            pShm->pHeader   = pHeader;
+            pShm->pSummary  = (ATOMIC uint32_t *)((uint8_t *)pHeader + pHeader->sumOffset);
+            pShm->pFreeMap  = (ATOMIC uint32_t *)((uint8_t *)pHeader + pHeader->mapOffset);
+            pShm->pDirty    = (ATOMIC uint32_t *)((uint8_t *)pHeader + pHeader->dirtyOffset);
+            pShm->pPool     = (uint8_t *)pHeader + pHeader->poolOffset;
+            pShm->fd        = fd;
+            pShm->recovered = false;
+        }
+        else
+        {
+            (void)ATOMIC_FETCH_SUB(&pHeader->attached, 1U);
+            (void)munmap(pHeader, size);
+        }
+    }
+    else
+    {
+        /* Do nothing */
+    }
+    return pShm;
+}
+
+/**
+ * @brief Write whole buffer, retrying short writes
+ * 
+ * @param fd File descriptor
+ * @param pData Data to write
+ * @param size Number of bytes
+ * @return true All bytes written
+ * @return false Write failed
+ */
+static bool shm_write_all(int fd, const void * pData, size_t size)
+{
+    const uint8_t * pByte = pData;
+    bool ok = true;
+    while (ok && (0U < size))
+    {
+        ssize_t written = write(fd, pByte, size);
+        ok = (0 < written);
+        if (ok)
+        {
+            pByte += written;
+            size -= (size_t)written;
+        }
+        else
+        {
+            /* Write failed */
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief Read into buffer until full, end of file or error
+ * 
+ * @param fd File descriptor
+ * @param pData Buffer
+ * @param size Number of bytes
+ * @return size_t Number of bytes read, less than size at end of file or on error
+ */
+static size_t shm_read_all(int fd, void * pData, size_t size)
+{
+    uint8_t * pByte = pData;
+    size_t total = 0U;
+    bool more = true;
+    while (more && (total < size))
+    {
+        ssize_t got = read(fd, &pByte[total], size - total);
+        more = (0 < got);
+        total += more ? (size_t)got : 0U;
+    }
+    return total;
+}
+
+/**
+ * @brief Lock whole file for this open file description, released on close or process death
+ * 
+ * Open file description locks conflict between descriptors of the same process
+ * too and convert atomically. Process locks are used where they are not available.
+ * 
+ * @param fd File descriptor
+ * @param type F_RDLCK or F_WRLCK
+ * @param wait Wait for conflicting locks to be released
+ * @return true Lock taken
+ * @return false Conflicting lock held
+ */
+static bool shm_file_lock(int fd, short type, bool wait)
+{
+    struct flock lock = { .l_type = type, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0 };
+#ifdef F_OFD_SETLK
+    int cmd = wait ? F_OFD_SETLKW : F_OFD_SETLK;
+#else
+    int cmd = wait ? F_SETLKW : F_SETLK;
+#endif
+    return (0 == fcntl(fd, cmd, &lock));
+}
+
+#endif
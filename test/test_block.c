@@ -4,9 +4,20 @@
 /* Standard library includes */
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 
 /* Files under test includes */
 #include "block.h"
+#include "block_fallback.h"
+#include "block_shm.h"
 
 #ifdef ALLOC_BLOCK_SIZE
 #define BLOCK_SIZE (ALLOC_BLOCK_SIZE)
@@ -20,6 +31,22 @@
 #define BLOCK_NUMS (10U) // Default value
 #endif
 
+#define BLOCK_COLOR_LINE (64U)
+
+#ifdef ALLOC_CACHE_COLORING
+#define BLOCK_STRIDE (BLOCK_SIZE + BLOCK_COLOR_LINE) // Colored variant uses large power of two block size
+#else
+#define BLOCK_STRIDE (BLOCK_SIZE)
+#endif
+
+#ifdef ALLOC_NUM_SHARDS
+#define BLOCK_SHARDS (ALLOC_NUM_SHARDS)
+#else
+#define BLOCK_SHARDS (1U)
+#endif
+
+#define BLOCK_SHARD_SPAN ((BLOCK_NUMS + BLOCK_SHARDS - 1U) / BLOCK_SHARDS)
+
 
 void setUp(void)
 {
@@ -81,7 +108,7 @@ void test_inbetween_alloc(void)
     uint8_t *pBlock = NULL;
     uint8_t *pTestBlock = NULL; // Inbetween block
     size_t num_of_blocks = BLOCK_NUMS; // Defined in block.c
-    size_t blockSize = BLOCK_SIZE;
+    size_t blockSize = BLOCK_STRIDE; // Distance between block starts
     for(size_t index = 0U; index <  num_of_blocks; index++)
     {
         pBlock = block_alloc();
@@ -117,6 +144,1373 @@ void test_dealloc_nonaligned(void)
     TEST_ASSERT_EQUAL(0xFFU, *pBlock); // Data should still persist 
 }
 
+/* Test pool ownership range check */
+void test_owns(void)
+{
+    // Given
+    uint8_t foreign[BLOCK_SIZE];
+    uint8_t * pBlock = block_alloc();
+    TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+    // When / Then
+    TEST_ASSERT_TRUE(block_owns(pBlock));
+    TEST_ASSERT_TRUE(block_owns(pBlock + BLOCK_SIZE - 1U));
+    TEST_ASSERT_FALSE(block_owns(foreign));
+    TEST_ASSERT_FALSE(block_owns(NULL));
+}
+
+/* Test mapping of interior pointer to block start */
+void test_base_of(void)
+{
+    // Given
+    uint8_t foreign[BLOCK_SIZE];
+    uint8_t * pBlock = block_alloc();
+    TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+    // When / Then
+    TEST_ASSERT_EQUAL_PTR(pBlock, block_base_of(pBlock));
+    TEST_ASSERT_EQUAL_PTR(pBlock, block_base_of(pBlock + 1U));
+    TEST_ASSERT_EQUAL_PTR(pBlock, block_base_of(pBlock + BLOCK_SIZE - 1U));
+    TEST_ASSERT_EQUAL_PTR(NULL, block_base_of(foreign));
+}
+
+/* Freeing pointer outside of pool must not change pool state */
+void test_dealloc_foreign(void)
+{
+    // Given
+    uint8_t foreign[BLOCK_SIZE * 2U];
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        TEST_ASSERT_NOT_EQUAL(NULL, block_alloc());
+    }
+    foreign[0] = 0xABU;
+    // When
+    block_free(foreign);
+    block_free(foreign + BLOCK_SIZE);
+    // Then
+    TEST_ASSERT_EQUAL(0xABU, foreign[0]); // Foreign memory untouched
+    TEST_ASSERT_EQUAL(NULL, block_alloc()); // Pool still full
+}
+
+#ifndef EMBEDDED_TARGET
+/* Test fallback from pool to heap and routing of free to owner */
+void test_fallback_heap(void)
+{
+    // Given
+    block_fallback_t fallback;
+    uint8_t * pBlocks[BLOCK_NUMS];
+    block_fallback_init(&fallback, &blockPoolAllocator, &blockHeapAllocator);
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pBlocks[index] = block_fallback_alloc(&fallback);
+        TEST_ASSERT_TRUE(block_owns(pBlocks[index]));
+    }
+    // When
+    uint8_t * pOverflow = block_fallback_alloc(&fallback);
+    // Then
+    TEST_ASSERT_NOT_EQUAL(NULL, pOverflow);
+    TEST_ASSERT_FALSE(block_owns(pOverflow));
+    TEST_ASSERT_TRUE(block_fallback_owns(&fallback, pOverflow));
+    block_fallback_free(&fallback, pOverflow); // Routed to heap
+    block_fallback_free(&fallback, pBlocks[0]); // Routed to pool
+    uint8_t * pBlock = block_fallback_alloc(&fallback);
+    TEST_ASSERT_TRUE(block_owns(pBlock)); // Pool serves again
+    block_fallback_free(&fallback, pBlock);
+}
+
+/* Test fallback chains can be composed */
+void test_fallback_chain(void)
+{
+    // Given
+    block_fallback_t inner;
+    block_fallback_t outer;
+    block_fallback_init(&inner, &blockPoolAllocator, &blockHeapAllocator);
+    block_allocator_t innerAllocator = block_fallback_allocator(&inner);
+    block_fallback_init(&outer, &blockPoolAllocator, &innerAllocator);
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        TEST_ASSERT_NOT_EQUAL(NULL, block_fallback_alloc(&outer));
+    }
+    // When
+    uint8_t * pOverflow = block_fallback_alloc(&outer);
+    // Then
+    TEST_ASSERT_NOT_EQUAL(NULL, pOverflow);
+    TEST_ASSERT_FALSE(block_owns(pOverflow));
+    TEST_ASSERT_EQUAL_PTR(NULL, innerAllocator.owns); // Heap terminated chain is catch-all
+    block_fallback_free(&outer, pOverflow);
+}
+#endif
+
+/* Test handle dereference and stale handle detection */
+void test_handle(void)
+{
+    // Given
+    block_handle_t handle = block_alloc_h();
+    block_handle_t reused = BLOCK_HANDLE_NIL;
+    uint8_t * pBlock = block_deref(handle);
+    TEST_ASSERT_EQUAL(4U, sizeof(block_handle_t));
+    TEST_ASSERT_NOT_EQUAL(BLOCK_HANDLE_NIL, handle);
+    TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+    TEST_ASSERT_TRUE(block_owns(pBlock));
+    TEST_ASSERT_EQUAL(NULL, block_deref(BLOCK_HANDLE_NIL));
+    TEST_ASSERT_FALSE(block_free_h(BLOCK_HANDLE_NIL));
+    // When
+    TEST_ASSERT_TRUE(block_free_h(handle));
+    // Then
+    TEST_ASSERT_EQUAL(NULL, block_deref(handle)); // Use after free
+    TEST_ASSERT_FALSE(block_free_h(handle));      // Double free
+    reused = block_alloc_h();
+    TEST_ASSERT_NOT_EQUAL(handle, reused);
+    TEST_ASSERT_EQUAL(NULL, block_deref(handle));
+    pBlock = block_deref(reused);
+    TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+    block_free(pBlock); // Pointer free invalidates handle as well
+    TEST_ASSERT_EQUAL(NULL, block_deref(reused));
+    block_free(pBlock); // Double free leaves generation alone
+    handle = block_alloc_h();
+    if (pBlock == block_deref(handle))
+    {
+        TEST_ASSERT_EQUAL_HEX32(reused + 0x01000000U, handle); // Generation above 24 index bits, advanced once
+    }
+    else
+    {
+        /* Mode does not hand same block back */
+    }
+    TEST_ASSERT_TRUE(block_free_h(handle));
+    handle = block_alloc_h();
+    block_reset_all();
+    TEST_ASSERT_EQUAL(NULL, block_deref(handle));
+    TEST_ASSERT_FALSE(block_free_h(handle)); // Dropped by reset, block is free
+    reused = block_alloc_h();
+    if ((reused & 0x00FFFFFFU) == (handle & 0x00FFFFFFU))
+    {
+        TEST_ASSERT_EQUAL_HEX32(handle + 0x01000000U, reused); // Advanced by reset only, not by failed free
+    }
+    else
+    {
+        /* Mode does not hand same block back */
+    }
+    TEST_ASSERT_TRUE(block_free_h(reused));
+}
+
+static uint8_t * volatile pSignalHeld = NULL;  /* Block held by signal handler between signals */
+static volatile size_t signalAllocs = 0U;       /* Allocations served inside signal handler */
+static volatile bool signalStop = false;        /* Stops signal sender thread */
+
+/* Signal handler allocating a block and freeing the one taken by previous signal */
+static void signal_churn_handler(int sig)
+{
+    (void)sig;
+    uint8_t * pBlock = block_try_alloc();
+    if (NULL != pBlock)
+    {
+        pBlock[0] = 0x5AU;
+        signalAllocs++;
+    }
+    if (NULL != pSignalHeld)
+    {
+        (void)block_try_free(pSignalHeld);
+    }
+    pSignalHeld = pBlock;
+}
+
+/* Thread firing signals at given thread until stopped */
+static void * signal_sender_thread(void * pArg)
+{
+    pthread_t target = *(pthread_t *)pArg;
+    while (!signalStop)
+    {
+        (void)pthread_kill(target, SIGUSR1);
+        usleep(20U);
+    }
+    return NULL;
+}
+
+/* Test signal handlers allocate and free during churn without deadlock or leak */
+void test_signal_alloc(void)
+{
+    // Given
+    uint8_t * pBlocks[BLOCK_NUMS];
+    struct sigaction action;
+    struct sigaction previous;
+    pthread_t self = pthread_self();
+    pthread_t sender;
+    block_stats_t stats;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = signal_churn_handler;
+    sigemptyset(&action.sa_mask);
+    pSignalHeld = NULL;
+    signalAllocs = 0U;
+    signalStop = false;
+    TEST_ASSERT_EQUAL(0, sigaction(SIGUSR1, &action, &previous));
+    TEST_ASSERT_EQUAL(0, pthread_create(&sender, NULL, signal_sender_thread, &self));
+    // When
+    for (size_t round = 0U; (round < 2000U) || (0U == signalAllocs); round++)
+    {
+        size_t count = 0U;
+        for (uint8_t * pBlock = block_alloc(); NULL != pBlock; pBlock = (count < BLOCK_NUMS) ? block_alloc() : NULL)
+        {
+            pBlock[BLOCK_SIZE - 1U] = (uint8_t)round;
+            pBlocks[count] = pBlock;
+            count++;
+        }
+        while (0U < count)
+        {
+            count--;
+            block_free(pBlocks[count]);
+        }
+    }
+    signalStop = true;
+    TEST_ASSERT_EQUAL(0, pthread_join(sender, NULL));
+    TEST_ASSERT_EQUAL(0, sigaction(SIGUSR1, &previous, NULL));
+    block_free(pSignalHeld);
+    // Then
+    block_get_stats(&stats);
+    TEST_ASSERT_EQUAL(0U, stats.blocksUsed);
+    TEST_ASSERT_FALSE(block_try_free(pSignalHeld)); // Already freed
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        TEST_ASSERT_NOT_EQUAL(NULL, block_try_alloc());
+    }
+    TEST_ASSERT_EQUAL(NULL, block_try_alloc());
+}
+
+/* Test statistics follow allocations */
+void test_stats(void)
+{
+    // Given
+    block_stats_t stats;
+    uint8_t * pBlock = block_alloc();
+    TEST_ASSERT_NOT_EQUAL(NULL, block_alloc());
+    TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+    // When
+    block_free(pBlock);
+    block_get_stats(&stats);
+    // Then
+    TEST_ASSERT_EQUAL(BLOCK_NUMS, stats.blocksTotal);
+    TEST_ASSERT_EQUAL(1U, stats.blocksUsed);
+}
+
+/* Allocate all blocks from another thread */
+static void * alloc_all_thread(void * pArg)
+{
+    size_t * pCount = (size_t *)pArg;
+    while (NULL != block_alloc())
+    {
+        (*pCount)++;
+    }
+    return NULL;
+}
+
+/* Test thread with empty home shard/sub-pool gets blocks from others and it is visible in stats */
+void test_steal_stats(void)
+{
+    // Given
+    pthread_t thread;
+    size_t count = 0U;
+    block_stats_t stats;
+    // When
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, alloc_all_thread, &count));
+    TEST_ASSERT_EQUAL(0, pthread_join(thread, NULL));
+    block_get_stats(&stats);
+    // Then
+    TEST_ASSERT_EQUAL(BLOCK_NUMS, count); // Whole pool usable from single thread
+    TEST_ASSERT_EQUAL(BLOCK_NUMS, stats.blocksUsed);
+#ifdef ALLOC_NUM_SHARDS
+    if (1 < ALLOC_NUM_SHARDS)
+    {
+        TEST_ASSERT_NOT_EQUAL(0U, stats.stealAttempts);
+        TEST_ASSERT_NOT_EQUAL(0U, stats.steals);
+        TEST_ASSERT_NOT_EQUAL(0U, stats.blocksStolen);
+        TEST_ASSERT_TRUE(stats.steals <= stats.stealAttempts);
+    }
+#endif
+}
+
+#ifndef EMBEDDED_TARGET
+#ifndef ALLOC_HARD_REALTIME
+/* Blocking allocation argument and result */
+typedef struct
+{
+    uint64_t timeoutNs;
+    void * pBlock;
+    size_t * pOrder; /* Shared completion counter */
+    size_t order;    /* Completion position of this waiter */
+} wait_arg_t;
+
+static void * alloc_wait_thread(void * pArg)
+{
+    wait_arg_t * pWait = (wait_arg_t *)pArg;
+    pWait->pBlock = block_alloc_wait(pWait->timeoutNs);
+    pWait->order = __atomic_add_fetch(pWait->pOrder, 1U, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+/* Wait until given number of callers is parked in block_alloc_wait() */
+static void wait_for_waiters(size_t waiters)
+{
+    block_stats_t stats;
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 1000000 };
+    do
+    {
+        nanosleep(&pause, NULL);
+        block_get_stats(&stats);
+    } while (stats.waiters != waiters);
+}
+
+/* Test blocking allocation times out on exhausted pool */
+void test_alloc_wait_timeout(void)
+{
+    // Given
+    struct timespec start;
+    struct timespec end;
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        TEST_ASSERT_NOT_EQUAL(NULL, block_alloc());
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc_wait(0U)); // No waiting
+    // When
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    void * pBlock = block_alloc_wait(20000000U); // 20 ms
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    // Then
+    TEST_ASSERT_EQUAL(NULL, pBlock);
+    int64_t elapsedNs = ((int64_t)(end.tv_sec - start.tv_sec) * 1000000000) + (end.tv_nsec - start.tv_nsec);
+    TEST_ASSERT_TRUE(elapsedNs >= 20000000);
+}
+
+/* Test waiters are served in FIFO order as blocks are freed */
+void test_alloc_wait_fifo(void)
+{
+    // Given
+    pthread_t threads[2];
+    wait_arg_t args[2];
+    size_t order = 0U;
+    uint8_t * pBlocks[BLOCK_NUMS];
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pBlocks[index] = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlocks[index]);
+    }
+    for (size_t thread = 0U; thread < 2U; thread++)
+    {
+        args[thread].timeoutNs = BLOCK_WAIT_FOREVER;
+        args[thread].pBlock = NULL;
+        args[thread].pOrder = &order;
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[thread], NULL, alloc_wait_thread, &args[thread]));
+        wait_for_waiters(thread + 1U); // Queue in known order
+    }
+    // When
+    block_free(pBlocks[0]);
+    wait_for_waiters(1U);
+    block_free(pBlocks[1]);
+    TEST_ASSERT_EQUAL(0, pthread_join(threads[0], NULL));
+    TEST_ASSERT_EQUAL(0, pthread_join(threads[1], NULL));
+    // Then
+    TEST_ASSERT_EQUAL_PTR(pBlocks[0], args[0].pBlock); // First waiter got first freed block
+    TEST_ASSERT_EQUAL_PTR(pBlocks[1], args[1].pBlock);
+    TEST_ASSERT_EQUAL(1U, args[0].order);
+    TEST_ASSERT_EQUAL(2U, args[1].order);
+}
+
+/* Check if descriptor is readable without blocking */
+static bool fd_readable(int fd)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+    return (1 == poll(&pfd, 1, 0));
+}
+
+/* Test pool descriptor becomes readable once free blocks rise above watermark after exhaustion */
+void test_pool_fd(void)
+{
+    // Given
+    uint64_t value = 0U;
+    uint8_t * pBlocks[BLOCK_NUMS];
+    int fd = block_pool_fd();
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(fd, block_pool_fd()); // Same descriptor on every call
+    block_set_low_watermark(2U);
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pBlocks[index] = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlocks[index]);
+    }
+    block_free(pBlocks[0]); // Not exhausted yet, nothing armed
+    TEST_ASSERT_FALSE(fd_readable(fd));
+    pBlocks[0] = block_alloc();
+    // When
+    TEST_ASSERT_EQUAL(NULL, block_alloc()); // Exhausted
+    block_free(pBlocks[0]);
+    block_free(pBlocks[1]);
+    // Then
+    TEST_ASSERT_FALSE(fd_readable(fd)); // Two free blocks, not above watermark
+    block_free(pBlocks[2]);
+    TEST_ASSERT_TRUE(fd_readable(fd));
+    TEST_ASSERT_EQUAL(sizeof(value), read(fd, &value, sizeof(value)));
+    block_free(pBlocks[3]); // Notified once per exhaustion
+    TEST_ASSERT_FALSE(fd_readable(fd));
+    block_set_low_watermark(0U);
+}
+
+/* Test waiter and pool descriptor notice block freed from signal context */
+void test_alloc_wait_try_free(void)
+{
+    // Given
+    pthread_t thread;
+    size_t order = 0U;
+    uint64_t value = 0U;
+    wait_arg_t arg = { .timeoutNs = BLOCK_WAIT_FOREVER, .pBlock = NULL, .pOrder = &order, .order = 0U };
+    uint8_t * pBlocks[BLOCK_NUMS];
+    int fd = block_pool_fd();
+    TEST_ASSERT_TRUE(fd >= 0);
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pBlocks[index] = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlocks[index]);
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc()); // Exhausted, descriptor armed
+    TEST_ASSERT_FALSE(fd_readable(fd));
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, alloc_wait_thread, &arg));
+    wait_for_waiters(1U);
+    // When
+    TEST_ASSERT_TRUE(block_try_free(pBlocks[0]));
+    // Then
+    TEST_ASSERT_TRUE(fd_readable(fd));
+    TEST_ASSERT_EQUAL(sizeof(value), read(fd, &value, sizeof(value)));
+    TEST_ASSERT_EQUAL(0, pthread_join(thread, NULL)); // Merge by retry must not wake waiter under queue lock
+    TEST_ASSERT_EQUAL_PTR(pBlocks[0], arg.pBlock);
+}
+#endif
+
+/* Test block filled by one process is read and freed by index in another without copy */
+void test_shm_handoff(void)
+{
+    // Given
+    block_shm_t * pShm = block_shm_create(NULL, 64U, 40U);
+    uint32_t index = BLOCK_SHM_NIL;
+    pid_t pid = 0;
+    int status = -1;
+    TEST_ASSERT_NOT_EQUAL(NULL, pShm);
+    TEST_ASSERT_EQUAL(NULL, block_shm_create(NULL, 63U, 40U)); // Unaligned block size
+    index = block_shm_alloc(pShm);
+    TEST_ASSERT_NOT_EQUAL(BLOCK_SHM_NIL, index);
+    strcpy((char *)block_shm_ptr(pShm, index), "request");
+    // When
+    pid = fork();
+    if (0 == pid)
+    {
+        /* Child maps pool at own address, only index is shared */
+        block_shm_t * pChild = block_shm_attach(block_shm_fd(pShm));
+        char * pMsg = (NULL != pChild) ? block_shm_ptr(pChild, index) : NULL;
+        bool ok = (NULL != pMsg) && (0 == strcmp(pMsg, "request")) && (pMsg != block_shm_ptr(pShm, index));
+        if (ok)
+        {
+            strcpy(pMsg, "reply");
+            ok = block_shm_free(pChild, index) && !block_shm_free(pChild, index);
+        }
+        _exit(ok ? 0 : 1);
+    }
+    TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+    // Then
+    TEST_ASSERT_TRUE(WIFEXITED(status) && (0 == WEXITSTATUS(status)));
+    TEST_ASSERT_EQUAL_STRING("reply", (char *)block_shm_ptr(pShm, index));
+    TEST_ASSERT_EQUAL(index, block_shm_index_of(pShm, (uint8_t *)block_shm_ptr(pShm, index) + 10U));
+    for (size_t count = 0U; count < 40U; count++)
+    {
+        TEST_ASSERT_NOT_EQUAL(BLOCK_SHM_NIL, block_shm_alloc(pShm)); // Block freed by child is back
+    }
+    TEST_ASSERT_EQUAL(BLOCK_SHM_NIL, block_shm_alloc(pShm));
+    block_shm_detach(pShm);
+}
+
+/* Hammer pool from several processes, every block must be owned by one process at a time */
+static bool shm_hammer(block_shm_t * pShm, uint32_t tag)
+{
+    bool ok = true;
+    uint32_t held[8];
+    for (size_t round = 0U; (round < 2000U) && ok; round++)
+    {
+        for (size_t slot = 0U; slot < 8U; slot++)
+        {
+            held[slot] = block_shm_alloc(pShm);
+            ok = ok && (BLOCK_SHM_NIL != held[slot]);
+            if (BLOCK_SHM_NIL != held[slot])
+            {
+                *(volatile uint32_t *)block_shm_ptr(pShm, held[slot]) = tag;
+            }
+        }
+        for (size_t slot = 0U; slot < 8U; slot++)
+        {
+            if (BLOCK_SHM_NIL != held[slot])
+            {
+                ok = ok && (tag == *(volatile uint32_t *)block_shm_ptr(pShm, held[slot]));
+                ok = ok && block_shm_free(pShm, held[slot]);
+            }
+        }
+    }
+    return ok;
+}
+
+/* Test lock-free allocation from concurrent processes */
+void test_shm_concurrent(void)
+{
+    // Given
+    block_shm_t * pShm = block_shm_create(NULL, 32U, 100U);
+    pid_t pids[3];
+    size_t count = 0U;
+    TEST_ASSERT_NOT_EQUAL(NULL, pShm);
+    // When
+    for (size_t child = 0U; child < 3U; child++)
+    {
+        pids[child] = fork();
+        if (0 == pids[child])
+        {
+            _exit(shm_hammer(pShm, (uint32_t)child + 1U) ? 0 : 1);
+        }
+    }
+    TEST_ASSERT_TRUE(shm_hammer(pShm, 100U));
+    // Then
+    for (size_t child = 0U; child < 3U; child++)
+    {
+        int status = -1;
+        TEST_ASSERT_EQUAL(pids[child], waitpid(pids[child], &status, 0));
+        TEST_ASSERT_TRUE(WIFEXITED(status) && (0 == WEXITSTATUS(status)));
+    }
+    while (BLOCK_SHM_NIL != block_shm_alloc(pShm))
+    {
+        count++;
+    }
+    TEST_ASSERT_EQUAL(100U, count); // No block lost or duplicated
+    block_shm_detach(pShm);
+}
+
+/* Test blocks placed in a file survive re-attach, unclean shutdown rebuilds summary */
+void test_shm_file_persist(void)
+{
+    // Given
+    char path[] = "/tmp/block_shm_XXXXXX";
+    int fd = mkstemp(path);
+    block_shm_t * pShm = NULL;
+    uint32_t index[3];
+    pid_t pid = 0;
+    int status = -1;
+    size_t count = 0U;
+    TEST_ASSERT_TRUE(0 <= fd);
+    (void)close(fd);
+    pShm = block_shm_map_file(path, 32U, 100U);
+    TEST_ASSERT_NOT_EQUAL(NULL, pShm);
+    TEST_ASSERT_FALSE(block_shm_recovered(pShm));
+    for (size_t slot = 0U; slot < 3U; slot++)
+    {
+        index[slot] = block_shm_alloc(pShm);
+        TEST_ASSERT_NOT_EQUAL(BLOCK_SHM_NIL, index[slot]);
+        snprintf((char *)block_shm_ptr(pShm, index[slot]), 32U, "block %u", (unsigned)slot);
+    }
+    block_shm_detach(pShm);
+    // When
+    pShm = block_shm_map_file(path, 0U, 0U);
+    // Then
+    TEST_ASSERT_NOT_EQUAL(NULL, pShm);
+    TEST_ASSERT_FALSE(block_shm_recovered(pShm)); // Clean shutdown
+    TEST_ASSERT_EQUAL(NULL, block_shm_map_file(path, 64U, 0U)); // Other geometry
+    TEST_ASSERT_EQUAL_STRING("block 1", (char *)block_shm_ptr(pShm, index[1]));
+    TEST_ASSERT_TRUE(block_shm_free(pShm, index[2])); // Still allocated after re-attach
+    TEST_ASSERT_FALSE(block_shm_free(pShm, index[2]));
+    block_shm_detach(pShm);
+    // When
+    pid = fork();
+    if (0 == pid)
+    {
+        /* Dies with block allocated and without detaching */
+        block_shm_t * pChild = block_shm_map_file(path, 0U, 0U);
+        uint32_t crashed = block_shm_alloc(pChild);
+        if (BLOCK_SHM_NIL != crashed)
+        {
+            strcpy((char *)block_shm_ptr(pChild, crashed), "crashed");
+        }
+        _exit((int)crashed);
+    }
+    TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status));
+    pShm = block_shm_map_file(path, 0U, 0U);
+    // Then
+    TEST_ASSERT_NOT_EQUAL(NULL, pShm);
+    TEST_ASSERT_TRUE(block_shm_recovered(pShm));
+    TEST_ASSERT_EQUAL_STRING("crashed", (char *)block_shm_ptr(pShm, (uint32_t)WEXITSTATUS(status)));
+    while (BLOCK_SHM_NIL != block_shm_alloc(pShm))
+    {
+        count++;
+    }
+    TEST_ASSERT_EQUAL(100U - 3U, count); // Two blocks from first run and one of crashed process kept
+    block_shm_detach(pShm);
+    // When
+    pShm = block_shm_map_file(path, 0U, 0U);
+    // Then
+    TEST_ASSERT_NOT_EQUAL(NULL, pShm);
+    TEST_ASSERT_FALSE(block_shm_recovered(pShm)); // Attach count of crashed process dropped by recovery
+    block_shm_detach(pShm);
+    pShm = block_shm_map_file(path, 0U, 0U);
+    TEST_ASSERT_NOT_EQUAL(NULL, pShm);
+    TEST_ASSERT_FALSE(block_shm_recovered(pShm));
+    // When
+    pid = fork();
+    if (0 == pid)
+    {
+        /* Attaches while parent still has pool mapped */
+        block_shm_t * pChild = block_shm_map_file(path, 0U, 0U);
+        int peerRecovered = ((NULL == pChild) || block_shm_recovered(pChild)) ? 1 : 0;
+        block_shm_detach(pChild);
+        _exit(peerRecovered);
+    }
+    TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+    // Then
+    TEST_ASSERT_TRUE(WIFEXITED(status));
+    TEST_ASSERT_EQUAL(0, WEXITSTATUS(status)); // Live peer is no crash
+    block_shm_detach(pShm);
+    pShm = block_shm_map_file(path, 0U, 0U);
+    TEST_ASSERT_NOT_EQUAL(NULL, pShm);
+    TEST_ASSERT_FALSE(block_shm_recovered(pShm)); // Both detached properly
+    block_shm_detach(pShm);
+    (void)unlink(path);
+}
+
+/* Test base snapshot plus incremental checkpoint restores pool, delta holds only dirty blocks */
+void test_shm_checkpoint(void)
+{
+    // Given
+    char path[] = "/tmp/block_ckpt_XXXXXX";
+    int fd = mkstemp(path);
+    block_shm_t * pShm = block_shm_create(NULL, 64U, 100U);
+    block_shm_t * pCopy = block_shm_create(NULL, 64U, 100U);
+    uint32_t index[5];
+    off_t baseSize = 0;
+    off_t deltaSize = 0;
+    size_t count = 0U;
+    TEST_ASSERT_TRUE(0 <= fd);
+    TEST_ASSERT_NOT_EQUAL(NULL, pShm);
+    TEST_ASSERT_NOT_EQUAL(NULL, pCopy);
+    for (size_t slot = 0U; slot < 5U; slot++)
+    {
+        index[slot] = block_shm_alloc(pShm);
+        snprintf((char *)block_shm_ptr(pShm, index[slot]), 64U, "base %u", (unsigned)slot);
+    }
+    TEST_ASSERT_TRUE(block_shm_checkpoint(pShm, fd, true));
+    baseSize = lseek(fd, 0, SEEK_CUR);
+    // When
+    strcpy((char *)block_shm_ptr(pShm, index[1]), "modified");
+    block_shm_mark_dirty(pShm, index[1]);
+    strcpy((char *)block_shm_ptr(pShm, index[2]), "not marked"); // Not part of delta
+    TEST_ASSERT_TRUE(block_shm_free(pShm, index[4]));
+    index[4] = block_shm_alloc(pShm); // Reuses freed block, dirty by allocation
+    strcpy((char *)block_shm_ptr(pShm, index[4]), "new");
+    TEST_ASSERT_TRUE(block_shm_free(pShm, index[3]));
+    TEST_ASSERT_TRUE(block_shm_checkpoint(pShm, fd, false));
+    deltaSize = lseek(fd, 0, SEEK_CUR) - baseSize;
+    TEST_ASSERT_EQUAL(0, lseek(fd, 0, SEEK_SET));
+    TEST_ASSERT_TRUE(block_shm_restore(pCopy, fd));
+    // Then
+    TEST_ASSERT_EQUAL(3 * (sizeof(uint32_t) + 64U), (size_t)(baseSize - deltaSize)); // Two records instead of five
+    TEST_ASSERT_EQUAL_STRING("base 0", (char *)block_shm_ptr(pCopy, index[0]));
+    TEST_ASSERT_EQUAL_STRING("modified", (char *)block_shm_ptr(pCopy, index[1]));
+    TEST_ASSERT_EQUAL_STRING("base 2", (char *)block_shm_ptr(pCopy, index[2]));
+    TEST_ASSERT_EQUAL_STRING("new", (char *)block_shm_ptr(pCopy, index[4]));
+    TEST_ASSERT_FALSE(block_shm_free(pCopy, index[3])); // Freed before delta
+    while (BLOCK_SHM_NIL != block_shm_alloc(pCopy))
+    {
+        count++;
+    }
+    TEST_ASSERT_EQUAL(100U - 4U, count);
+    block_shm_detach(pShm);
+    block_shm_detach(pCopy);
+    (void)close(fd);
+    (void)unlink(path);
+}
+#endif
+
+#if !defined(ALLOC_WORK_STEALING) && !defined(ALLOC_PREFAULT) && !defined(ALLOC_HARD_REALTIME) && !defined(EMBEDDED_TARGET)
+/* Test whole free pages of pool are returned to the OS and read back as zero */
+void test_trim(void)
+{
+    // Given
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t poolPages = (BLOCK_STRIDE * BLOCK_NUMS) / pageSize;
+    uint8_t * pBlocks[BLOCK_NUMS];
+    block_stats_t stats;
+    size_t released = 0U;
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pBlocks[index] = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlocks[index]);
+        memset(pBlocks[index], 0xA5, BLOCK_SIZE);
+    }
+    TEST_ASSERT_EQUAL(0U, block_trim()); // Nothing free
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        block_free(pBlocks[index]);
+    }
+    // When
+    released = block_trim();
+    block_get_stats(&stats);
+    // Then
+    TEST_ASSERT_EQUAL(poolPages * pageSize, released);
+    TEST_ASSERT_EQUAL(released, stats.trimmedBytes);
+    TEST_ASSERT_EQUAL(2U, stats.trims);
+    TEST_ASSERT_TRUE(stats.residentBytes <= pageSize); // Partial tail page may stay
+    pBlocks[0] = block_alloc();
+    TEST_ASSERT_NOT_EQUAL(NULL, pBlocks[0]);
+    TEST_ASSERT_EACH_EQUAL_UINT8(0U, pBlocks[0], BLOCK_SIZE);
+}
+
+static volatile bool trimStop = false; /* Stops trimming thread */
+
+/* Trim pool in a loop until stopped */
+static void * trim_loop_thread(void * pArg)
+{
+    size_t * pPasses = (size_t *)pArg;
+    while (!trimStop)
+    {
+        (void)block_trim();
+        (void)__atomic_add_fetch(pPasses, 1U, __ATOMIC_SEQ_CST);
+    }
+    return NULL;
+}
+
+/* Test allocation proceeds during trim passes and blocks taken by trim are handed back */
+void test_trim_concurrent(void)
+{
+    // Given
+    pthread_t thread;
+    size_t passes = 0U;
+    uint8_t * pBlocks[BLOCK_NUMS];
+    trimStop = false;
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, trim_loop_thread, &passes));
+    // When
+    for (size_t round = 0U; (round < 2000U) || (__atomic_load_n(&passes, __ATOMIC_SEQ_CST) < 10U); round++)
+    {
+        uint8_t * pBlock = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+        TEST_ASSERT_EACH_EQUAL_UINT8(0U, pBlock, BLOCK_SIZE);
+        memset(pBlock, 0xA5, BLOCK_SIZE);
+        block_free(pBlock);
+    }
+    trimStop = true;
+    TEST_ASSERT_EQUAL(0, pthread_join(thread, NULL));
+    // Then
+    TEST_ASSERT_NOT_EQUAL(0U, passes);
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pBlocks[index] = block_alloc(); // Every block taken by trim is back
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlocks[index]);
+        TEST_ASSERT_EACH_EQUAL_UINT8(0U, pBlocks[index], BLOCK_SIZE);
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc());
+}
+
+/* Test background policy trims pool once traffic drops */
+void test_trim_background(void)
+{
+    // Given
+    block_trim_policy_t policy = { .intervalMs = 5U, .minFreeBlocks = BLOCK_NUMS, .lazy = true };
+    block_stats_t stats;
+    uint8_t * pBlock = block_alloc();
+    TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+    TEST_ASSERT_FALSE(block_set_trim_policy(NULL));
+    TEST_ASSERT_TRUE(block_set_trim_policy(&policy));
+    // When
+    usleep(30000U);
+    block_get_stats(&stats);
+    TEST_ASSERT_EQUAL(0U, stats.trims); // Busy pool is not trimmed
+    block_free(pBlock);
+    for (size_t retry = 0U; (retry < 200U) && (0U == stats.trims); retry++)
+    {
+        usleep(5000U);
+        block_get_stats(&stats);
+    }
+    policy.intervalMs = 0U;
+    // Then
+    TEST_ASSERT_TRUE(block_set_trim_policy(&policy));
+    TEST_ASSERT_NOT_EQUAL(0U, stats.trims);
+}
+#endif
+
+#ifdef ALLOC_ADDRESS_ORDERED
+/* Test lowest free block is allocated first regardless of free order */
+void test_address_ordered(void)
+{
+    // Given
+    uint8_t * pBlocks[BLOCK_NUMS];
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pBlocks[index] = block_alloc();
+        TEST_ASSERT_EQUAL_PTR(pBlocks[0] + (index * BLOCK_STRIDE), pBlocks[index]);
+    }
+    // When
+    block_free(pBlocks[5]);
+    block_free(pBlocks[2]);
+    block_free(pBlocks[7]);
+    // Then
+    TEST_ASSERT_EQUAL_PTR(pBlocks[2], block_alloc());
+    TEST_ASSERT_EQUAL_PTR(pBlocks[5], block_alloc());
+    TEST_ASSERT_EQUAL_PTR(pBlocks[7], block_alloc());
+    TEST_ASSERT_EQUAL(NULL, block_alloc());
+}
+#endif
+
+#ifdef ALLOC_PREFAULT
+/* Test allocation churn after init causes no page faults */
+void test_prefault_churn(void)
+{
+    // Given
+    uint8_t * pBlocks[BLOCK_NUMS];
+    struct rusage before;
+    struct rusage after;
+    block_stats_t stats;
+    memset(pBlocks, 0, sizeof(pBlocks));
+    block_get_stats(&stats);
+    TEST_ASSERT_TRUE(stats.lockedBytes >= (BLOCK_SIZE * BLOCK_NUMS)); // Needs RLIMIT_MEMLOCK above pool size
+    TEST_ASSERT_TRUE(stats.residentBytes >= (BLOCK_SIZE * BLOCK_NUMS));
+    TEST_ASSERT_EQUAL(0, getrusage(RUSAGE_SELF, &before));
+    // When
+    for (size_t round = 0U; round < 1000U; round++)
+    {
+        for (size_t index = 0U; index < BLOCK_NUMS; index++)
+        {
+            pBlocks[index] = block_alloc();
+            pBlocks[index][BLOCK_SIZE - 1U] = (uint8_t)round;
+        }
+        for (size_t index = BLOCK_NUMS; index > 0U; index--)
+        {
+            block_free(pBlocks[(index * 7U) % BLOCK_NUMS]); // Scatter free list
+        }
+    }
+    TEST_ASSERT_EQUAL(0, getrusage(RUSAGE_SELF, &after));
+    // Then
+    TEST_ASSERT_EQUAL(before.ru_majflt, after.ru_majflt);
+    TEST_ASSERT_EQUAL(before.ru_minflt, after.ru_minflt);
+}
+#endif
+
+#ifdef ALLOC_CACHE_COLORING
+/* Test block starts are staggered over all cache line offsets within block size */
+void test_cache_coloring(void)
+{
+    // Given
+    size_t colors = BLOCK_SIZE / BLOCK_COLOR_LINE;
+    size_t expected = (BLOCK_NUMS < colors) ? BLOCK_NUMS : colors;
+    bool seen[BLOCK_SIZE / BLOCK_COLOR_LINE];
+    size_t distinct = 0U;
+    memset(seen, 0, sizeof(seen));
+    // When
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        uintptr_t addr = (uintptr_t)block_alloc();
+        TEST_ASSERT_NOT_EQUAL(0U, addr);
+        TEST_ASSERT_EQUAL(0U, addr % BLOCK_COLOR_LINE);
+        size_t color = (addr % BLOCK_SIZE) / BLOCK_COLOR_LINE;
+        distinct += seen[color] ? 0U : 1U;
+        seen[color] = true;
+    }
+    // Then
+    TEST_ASSERT_EQUAL(expected, distinct);
+    TEST_ASSERT_EQUAL(NULL, block_alloc());
+}
+#endif
+
+#if defined(ALLOC_NUM_TENANTS) && (ALLOC_NUM_TENANTS > 0)
+/* Test invalid tenant configurations are refused */
+void test_tenant_config(void)
+{
+    // Given / When / Then
+    TEST_ASSERT_FALSE(block_tenant_config(ALLOC_NUM_TENANTS, 0U, 1U)); // Invalid tenant
+    TEST_ASSERT_FALSE(block_tenant_config(1U, 3U, 2U)); // Reservation above cap
+    TEST_ASSERT_FALSE(block_tenant_config(1U, 0U, BLOCK_NUMS + 1U)); // Cap above pool
+    TEST_ASSERT_TRUE(block_tenant_config(1U, BLOCK_NUMS - 1U, BLOCK_NUMS));
+    TEST_ASSERT_FALSE(block_tenant_config(2U, 2U, BLOCK_NUMS)); // Reservations above pool
+    TEST_ASSERT_TRUE(block_tenant_config(2U, 1U, BLOCK_NUMS));
+}
+
+/* Test noisy tenant can not take reserved blocks of other tenant */
+void test_tenant_reservation(void)
+{
+    // Given
+    size_t count = 0U;
+    block_tenant_stats_t stats;
+    TEST_ASSERT_TRUE(block_tenant_config(1U, 3U, 5U));
+    // When
+    while (NULL != block_alloc_tenant(2U))
+    {
+        count++; // Noisy tenant
+    }
+    // Then
+    TEST_ASSERT_EQUAL(BLOCK_NUMS - 3U, count);
+    TEST_ASSERT_EQUAL(NULL, block_alloc()); // Default tenant has no reservation either
+    for (size_t index = 0U; index < 3U; index++)
+    {
+        TEST_ASSERT_NOT_EQUAL(NULL, block_alloc_tenant(1U));
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc_tenant(1U)); // Shared capacity used by noisy tenant
+    TEST_ASSERT_TRUE(block_get_tenant_stats(2U, &stats));
+    TEST_ASSERT_EQUAL(BLOCK_NUMS - 3U, stats.used);
+    TEST_ASSERT_EQUAL(1U, stats.rejected);
+    TEST_ASSERT_TRUE(block_get_tenant_stats(1U, &stats));
+    TEST_ASSERT_EQUAL(3U, stats.used);
+    TEST_ASSERT_EQUAL(3U, stats.reserved);
+    TEST_ASSERT_EQUAL(5U, stats.limit);
+    TEST_ASSERT_EQUAL(1U, stats.rejected);
+}
+
+/* Test tenant cap applies even when pool has free blocks */
+void test_tenant_limit(void)
+{
+    // Given
+    uint8_t * pBlocks[2];
+    block_tenant_stats_t stats;
+    TEST_ASSERT_TRUE(block_tenant_config(1U, 1U, 2U));
+    pBlocks[0] = block_alloc_tenant(1U);
+    pBlocks[1] = block_alloc_tenant(1U);
+    TEST_ASSERT_NOT_EQUAL(NULL, pBlocks[0]);
+    TEST_ASSERT_NOT_EQUAL(NULL, pBlocks[1]);
+    // When / Then
+    TEST_ASSERT_EQUAL(NULL, block_alloc_tenant(1U)); // Capped
+    block_free(pBlocks[1]);
+    block_free(pBlocks[1]); // Double free not accounted twice
+    TEST_ASSERT_TRUE(block_get_tenant_stats(1U, &stats));
+    TEST_ASSERT_EQUAL(1U, stats.used);
+    TEST_ASSERT_NOT_EQUAL(NULL, block_alloc_tenant(1U));
+    block_free(pBlocks[0]);
+    TEST_ASSERT_TRUE(block_get_tenant_stats(1U, &stats));
+    TEST_ASSERT_EQUAL(1U, stats.used);
+}
+#endif
+
+#ifdef ALLOC_PRIORITY_RESERVE
+/* Test emergency reserve is left for high priority allocations only */
+void test_prio_reserve(void)
+{
+    // Given
+    size_t count = 0U;
+    block_stats_t stats;
+    uint8_t * pHigh = NULL;
+    TEST_ASSERT_FALSE(block_set_reserve(BLOCK_NUMS + 1U));
+    TEST_ASSERT_TRUE(block_set_reserve(2U));
+    // When
+    while (NULL != block_alloc())
+    {
+        count++;
+    }
+    // Then
+    TEST_ASSERT_EQUAL(BLOCK_NUMS - 2U, count);
+    TEST_ASSERT_EQUAL(NULL, block_alloc_prio(BLOCK_PRIO_NORMAL));
+    pHigh = block_alloc_prio(BLOCK_PRIO_HIGH);
+    TEST_ASSERT_NOT_EQUAL(NULL, pHigh);
+    TEST_ASSERT_NOT_EQUAL(NULL, block_alloc_prio(BLOCK_PRIO_HIGH));
+    TEST_ASSERT_EQUAL(NULL, block_alloc_prio(BLOCK_PRIO_HIGH)); // Pool exhausted
+    block_free(pHigh);
+    block_free(pHigh); // Double free not accounted twice
+    TEST_ASSERT_EQUAL(NULL, block_alloc()); // Freed block refills reserve
+    TEST_ASSERT_NOT_EQUAL(NULL, block_alloc_prio(BLOCK_PRIO_HIGH));
+    block_get_stats(&stats);
+    TEST_ASSERT_EQUAL(2U, stats.reserve);
+    TEST_ASSERT_EQUAL(3U, stats.reserveRejected);
+}
+#endif
+
+#ifdef ALLOC_REMOTE_FREE
+/* Free all blocks of given array from another thread */
+static void * free_blocks_thread(void * pArg)
+{
+    uint8_t ** pBlocks = (uint8_t **)pArg;
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        block_free(pBlocks[index]);
+        block_free(pBlocks[index]); // Double free must be ignored
+    }
+    return NULL;
+}
+
+/* Test blocks freed by other thread are reclaimed by owner */
+void test_remote_free(void)
+{
+    // Given
+    pthread_t thread;
+    uint8_t * pBlocks[BLOCK_NUMS];
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pBlocks[index] = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlocks[index]);
+        *pBlocks[index] = 0xA5U;
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc());
+    // When
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, free_blocks_thread, pBlocks));
+    TEST_ASSERT_EQUAL(0, pthread_join(thread, NULL));
+    // Then
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        uint8_t * pBlock = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+        TEST_ASSERT_EQUAL(0U, *pBlock); // Expected erased block
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc()); // Each block reclaimed exactly once
+}
+#endif
+
+#ifndef ALLOC_WORK_STEALING
+/* Test run of adjacent blocks is usable as one buffer and returns to single block allocations */
+void test_contig_alloc(void)
+{
+    // Given
+    size_t count = (3U < BLOCK_SHARD_SPAN) ? 3U : BLOCK_SHARD_SPAN;
+    size_t singles = 0U;
+    uint8_t * pRun = NULL;
+    TEST_ASSERT_EQUAL(NULL, block_alloc_contig(0U));
+    TEST_ASSERT_EQUAL(NULL, block_alloc_contig(BLOCK_SHARD_SPAN + 1U)); // Runs never span shards
+    // When
+    pRun = block_alloc_contig(count);
+    TEST_ASSERT_NOT_EQUAL(NULL, pRun);
+    memset(pRun, 0xA5, count * BLOCK_SIZE);
+    for (uint8_t * pBlock = block_alloc(); NULL != pBlock; pBlock = block_alloc())
+    {
+        TEST_ASSERT_TRUE((pBlock < pRun) || (pBlock >= (pRun + (count * BLOCK_STRIDE))));
+        singles++;
+    }
+    // Then
+    TEST_ASSERT_EQUAL(BLOCK_NUMS - count, singles);
+    TEST_ASSERT_EQUAL(NULL, block_alloc_contig(1U));
+    block_free_contig(pRun, count);
+    for (size_t index = 0U; index < count; index++)
+    {
+        uint8_t * pBlock = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+        TEST_ASSERT_TRUE((pBlock >= pRun) && (pBlock < (pRun + (count * BLOCK_STRIDE))));
+        TEST_ASSERT_EQUAL(0U, pBlock[0]); // Expected erased block
+        TEST_ASSERT_EQUAL(0U, pBlock[BLOCK_SIZE - 1U]);
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc());
+}
+
+/* Check model of pool for free run, lowest run within each shard */
+static size_t contig_expected(const bool * pFree, size_t count)
+{
+    size_t start = SIZE_MAX;
+    for (size_t first = 0U; (first < BLOCK_NUMS) && (SIZE_MAX == start); first += BLOCK_SHARD_SPAN)
+    {
+        size_t end = ((first + BLOCK_SHARD_SPAN) < BLOCK_NUMS) ? (first + BLOCK_SHARD_SPAN) : BLOCK_NUMS;
+        size_t run = 0U;
+        for (size_t index = first; (index < end) && (SIZE_MAX == start); index++)
+        {
+            run = pFree[index] ? (run + 1U) : 0U;
+            start = (run == count) ? (index + 1U - count) : SIZE_MAX;
+        }
+    }
+    return start;
+}
+
+/* Test run search finds a run exactly when fragmented pool has one */
+void test_contig_fragmented(void)
+{
+    // Given
+    uint8_t * pBlocks[BLOCK_NUMS];
+    bool blockFree[BLOCK_NUMS];
+    uint8_t * pBase = NULL;
+    uint32_t seed = 2463534242U;
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        uint8_t * pBlock = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+        pBase = ((NULL == pBase) || (pBlock < pBase)) ? pBlock : pBase;
+    }
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pBlocks[index] = pBase + (index * BLOCK_STRIDE);
+    }
+    for (size_t round = 0U; round < 50U; round++)
+    {
+        // When
+        for (size_t index = 0U; index < BLOCK_NUMS; index++)
+        {
+            /* xorshift32, denser pools in later rounds */
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            blockFree[index] = ((seed % 50U) < (50U - round));
+            if (blockFree[index])
+            {
+                block_free(pBlocks[index]);
+            }
+        }
+        // Then
+        for (size_t count = 1U; count <= BLOCK_SHARD_SPAN; count++)
+        {
+            size_t expected = contig_expected(blockFree, count);
+            uint8_t * pRun = block_alloc_contig(count);
+            TEST_ASSERT_EQUAL(SIZE_MAX != expected, NULL != pRun);
+            if (NULL != pRun)
+            {
+                size_t start = (size_t)(pRun - pBase) / BLOCK_STRIDE;
+                TEST_ASSERT_EQUAL(start / BLOCK_SHARD_SPAN, (start + count - 1U) / BLOCK_SHARD_SPAN);
+                for (size_t index = start; index < (start + count); index++)
+                {
+                    TEST_ASSERT_TRUE(blockFree[index]);
+                }
+                if (1U == BLOCK_SHARDS)
+                {
+                    TEST_ASSERT_EQUAL(expected, start); // Lowest run
+                }
+                block_free_contig(pRun, count);
+            }
+        }
+        /* Take every free block back */
+        for (size_t index = 0U; index < BLOCK_NUMS; index++)
+        {
+            if (blockFree[index])
+            {
+                TEST_ASSERT_NOT_EQUAL(NULL, block_alloc());
+            }
+        }
+        TEST_ASSERT_EQUAL(NULL, block_alloc());
+    }
+}
+#endif
+
+/* Test hinted allocation takes nearest free block of hint neighbourhood, any block otherwise */
+void test_alloc_near(void)
+{
+    // Given
+    uint8_t * pBase = NULL;
+    uint8_t * pLast = NULL;
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        uint8_t * pBlock = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+        pBase = ((NULL == pBase) || (pBlock < pBase)) ? pBlock : pBase;
+    }
+    pLast = pBase + ((BLOCK_NUMS - 1U) * BLOCK_STRIDE);
+    // When
+    block_free(pBase + (2U * BLOCK_STRIDE));
+    uint8_t * pAfter = block_alloc_near(pBase + BLOCK_STRIDE);
+    block_free(pBase);
+    uint8_t * pBefore = block_alloc_near(pBase + BLOCK_STRIDE);
+    block_free(pLast);
+    uint8_t * pFar = block_alloc_near(pBase + BLOCK_STRIDE);
+    // Then
+#ifndef ALLOC_WORK_STEALING
+    TEST_ASSERT_EQUAL_PTR(pBase + (2U * BLOCK_STRIDE), pAfter); // Nearest after hint first
+    TEST_ASSERT_EQUAL_PTR(pBase, pBefore);
+#else
+    TEST_ASSERT_NOT_EQUAL(NULL, pAfter); // Plain allocation
+    TEST_ASSERT_NOT_EQUAL(NULL, pBefore);
+#endif
+    TEST_ASSERT_EQUAL_PTR(pLast, pFar); // Only free block
+    TEST_ASSERT_EQUAL(NULL, block_alloc_near(pBase + BLOCK_STRIDE));
+    TEST_ASSERT_EQUAL(NULL, block_alloc_near(NULL));
+    block_free(pBase + BLOCK_STRIDE);
+    TEST_ASSERT_EQUAL_PTR(pBase + BLOCK_STRIDE, block_alloc_near(NULL)); // No hint, plain allocation
+}
+
+/* Test scope end returns every scope block and record, nested scope rolls back on its own */
+void test_scope(void)
+{
+    // Given
+    block_scope_t outer;
+    block_scope_t inner;
+    size_t outerBlocks = 0U;
+    size_t innerBlocks = 0U;
+    block_scope_begin(&outer);
+    block_scope_begin(&inner);
+    block_scope_end(&inner); // Empty scope
+    for (size_t index = 0U; index < (BLOCK_NUMS / 2U); index++)
+    {
+        uint8_t * pBlock = block_scope_alloc(&outer);
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+        memset(pBlock, 0x5A, BLOCK_SIZE);
+        outerBlocks++;
+    }
+    // When
+    for (uint8_t * pBlock = block_scope_alloc(&inner); NULL != pBlock; pBlock = block_scope_alloc(&inner))
+    {
+        memset(pBlock, 0xA5, BLOCK_SIZE);
+        innerBlocks++;
+    }
+    TEST_ASSERT_TRUE((outerBlocks + innerBlocks) < BLOCK_NUMS); // Records take blocks too
+    block_scope_end(&inner);
+    // Then
+    TEST_ASSERT_EQUAL(NULL, inner.pRecord);
+    for (size_t index = 0U; index < innerBlocks; index++)
+    {
+        TEST_ASSERT_NOT_EQUAL(NULL, block_scope_alloc(&inner)); // Inner blocks are free again, outer kept
+    }
+    block_scope_end(&inner);
+    block_scope_end(&outer);
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        uint8_t * pBlock = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+        TEST_ASSERT_EQUAL(0U, pBlock[0]); // Expected erased block
+        TEST_ASSERT_EQUAL(0U, pBlock[BLOCK_SIZE - 1U]);
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc());
+}
+
+/* Test pool reset frees every block, stale pointers and handles are refused, epoch wrap included */
+void test_reset_all(void)
+{
+    // Given
+    block_stats_t stats;
+    block_handle_t handle = block_alloc_h();
+    uint8_t * pStale = block_alloc();
+    TEST_ASSERT_NOT_EQUAL(NULL, pStale);
+    memset(pStale, 0xA5, BLOCK_SIZE);
+    memset(block_deref(handle), 0x5A, BLOCK_SIZE);
+    // When
+    block_reset_all();
+    // Then
+    TEST_ASSERT_EQUAL(NULL, block_deref(handle));
+    block_free(pStale); // Stale, ignored
+    block_get_stats(&stats);
+    TEST_ASSERT_EQUAL(0U, stats.blocksUsed);
+#ifndef ALLOC_WORK_STEALING
+    uint8_t * pRun = block_alloc_contig(BLOCK_SHARD_SPAN); // Stale blocks count as free
+    TEST_ASSERT_NOT_EQUAL(NULL, pRun);
+    TEST_ASSERT_EQUAL(0U, pRun[0]);
+    block_free_contig(pRun, BLOCK_SHARD_SPAN);
+#endif
+    for (size_t reset = 0U; reset < 40U; reset++)
+    {
+        /* Dirty blocks across resets */
+        uint8_t * pBlock = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+        TEST_ASSERT_EQUAL(0U, pBlock[0]); // Expected erased block
+        memset(pBlock, 0xA5, BLOCK_SIZE);
+        block_reset_all();
+    }
+    handle = block_alloc_h();
+    pStale = block_deref(handle);
+    TEST_ASSERT_NOT_EQUAL(NULL, pStale);
+    memset(pStale, 0xA5, BLOCK_SIZE);
+    for (size_t reset = 0U; reset <= UINT16_MAX; reset++)
+    {
+        /* Epoch stamp wraps back to the one of stale block */
+        block_reset_all();
+    }
+    TEST_ASSERT_EQUAL(NULL, block_deref(handle));
+    block_free(pStale); // Stale, ignored
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        uint8_t * pBlock = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+        TEST_ASSERT_EQUAL(0U, pBlock[0]); // Expected erased block
+        TEST_ASSERT_EQUAL(0U, pBlock[BLOCK_SIZE - 1U]);
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc());
+}
+
+/* Test reset frees scope, stale scope neither writes nor reads records reused by others */
+void test_scope_reset(void)
+{
+    // Given
+    static uint8_t * pHeld[BLOCK_NUMS];
+    uint8_t * pBlock = NULL;
+    block_scope_t scope;
+    block_scope_begin(&scope);
+    TEST_ASSERT_NOT_EQUAL(NULL, block_scope_alloc(&scope));
+    TEST_ASSERT_NOT_EQUAL(NULL, block_scope_alloc(&scope));
+    block_reset_all();
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pHeld[index] = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pHeld[index]);
+    }
+    block_free(pHeld[BLOCK_NUMS - 1U]);
+    // When
+    pBlock = block_scope_alloc(&scope); // Only free block becomes new record
+    block_scope_end(&scope);
+    // Then
+    TEST_ASSERT_EQUAL(NULL, pBlock);
+    TEST_ASSERT_EQUAL(NULL, scope.pRecord);
+    for (size_t index = 0U; index < (BLOCK_NUMS - 1U); index++)
+    {
+        TEST_ASSERT_EACH_EQUAL_UINT8(0U, pHeld[index], BLOCK_SIZE); // Blocks of others untouched
+    }
+    TEST_ASSERT_NOT_EQUAL(NULL, block_alloc()); // New record only was freed
+    TEST_ASSERT_EQUAL(NULL, block_alloc());
+}
+
+/* Test shared block is freed by last reference only, copy on write keeps other holders intact */
+void test_block_refs(void)
+{
+    // Given
+    uint8_t * pShared = block_alloc();
+    uint8_t * pUnique = NULL;
+    TEST_ASSERT_NOT_EQUAL(NULL, pShared);
+    memset(pShared, 0xA5, BLOCK_SIZE);
+    TEST_ASSERT_TRUE(block_ref(pShared));
+    TEST_ASSERT_TRUE(block_ref(pShared)); // Three holders
+    TEST_ASSERT_FALSE(block_ref(pShared + 1U));
+    // When
+    pUnique = block_make_unique(pShared);
+    // Then
+    TEST_ASSERT_NOT_EQUAL(NULL, pUnique);
+    TEST_ASSERT_NOT_EQUAL(pShared, pUnique);
+    TEST_ASSERT_EQUAL_HEX8(0xA5, pUnique[BLOCK_SIZE - 1U]);
+    pUnique[0] = 0x5A;
+    TEST_ASSERT_EQUAL_HEX8(0xA5, pShared[0]); // Other holders see original
+    TEST_ASSERT_EQUAL_PTR(pUnique, block_make_unique(pUnique)); // Sole owner
+    TEST_ASSERT_FALSE(block_unref(pShared));
+    TEST_ASSERT_EQUAL_HEX8(0xA5, pShared[0]); // Still referenced
+    TEST_ASSERT_TRUE(block_unref(pShared));
+    TEST_ASSERT_FALSE(block_unref(pShared)); // Already free
+    TEST_ASSERT_FALSE(block_ref(pShared));
+    TEST_ASSERT_EQUAL(NULL, block_make_unique(pShared));
+    TEST_ASSERT_TRUE(block_unref(pUnique));
+    pShared = block_alloc();
+    TEST_ASSERT_TRUE(block_ref(pShared));
+    block_free(pShared); // Freed regardless of references
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        uint8_t * pBlock = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlock);
+        TEST_ASSERT_EQUAL(0U, pBlock[0]); // Expected erased block
+        TEST_ASSERT_EQUAL_PTR(pBlock, block_make_unique(pBlock)); // Reallocated blocks start unshared
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc());
+}
+
+#ifdef ALLOC_HARD_REALTIME
+/* Test allocation merges one block freed by signal handler at a time */
+void test_hard_rt_merge(void)
+{
+    // Given
+    uint8_t * pBlocks[BLOCK_NUMS];
+    block_stats_t stats;
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        pBlocks[index] = block_alloc();
+        TEST_ASSERT_NOT_EQUAL(NULL, pBlocks[index]);
+    }
+    // When
+    for (size_t index = 0U; index < BLOCK_NUMS; index++)
+    {
+        TEST_ASSERT_TRUE(block_try_free(pBlocks[index]));
+    }
+    // Then
+    for (size_t index = BLOCK_NUMS; index > 0U; index--)
+    {
+        /* Only merged block is free, most recently deferred one comes first */
+        TEST_ASSERT_EQUAL_PTR(pBlocks[index - 1U], block_alloc());
+    }
+    TEST_ASSERT_EQUAL(NULL, block_alloc());
+    for (size_t index = 0U; index < 2U; index++)
+    {
+        TEST_ASSERT_TRUE(block_try_free(pBlocks[index]));
+    }
+    block_get_stats(&stats);
+    TEST_ASSERT_EQUAL(BLOCK_NUMS - 2U, stats.blocksUsed); // Statistics merge whole list
+    for (size_t index = 2U; index < BLOCK_NUMS; index++)
+    {
+        block_free(pBlocks[index]);
+    }
+}
+#endif
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -126,5 +1520,65 @@ int main(void)
     RUN_TEST(test_dealloc);
     RUN_TEST(test_inbetween_alloc);
     RUN_TEST(test_dealloc_nonaligned);
+    RUN_TEST(test_owns);
+    RUN_TEST(test_base_of);
+    RUN_TEST(test_dealloc_foreign);
+#ifndef EMBEDDED_TARGET
+    RUN_TEST(test_fallback_heap);
+    RUN_TEST(test_fallback_chain);
+#endif
+    RUN_TEST(test_handle);
+    RUN_TEST(test_signal_alloc);
+    RUN_TEST(test_stats);
+    RUN_TEST(test_steal_stats);
+#ifndef EMBEDDED_TARGET
+#ifndef ALLOC_HARD_REALTIME
+    RUN_TEST(test_alloc_wait_timeout);
+    RUN_TEST(test_alloc_wait_fifo);
+    RUN_TEST(test_pool_fd);
+    RUN_TEST(test_alloc_wait_try_free);
+#endif
+    RUN_TEST(test_shm_handoff);
+    RUN_TEST(test_shm_concurrent);
+    RUN_TEST(test_shm_file_persist);
+    RUN_TEST(test_shm_checkpoint);
+#endif
+#if !defined(ALLOC_WORK_STEALING) && !defined(ALLOC_PREFAULT) && !defined(ALLOC_HARD_REALTIME) && !defined(EMBEDDED_TARGET)
+    RUN_TEST(test_trim);
+    RUN_TEST(test_trim_concurrent);
+    RUN_TEST(test_trim_background);
+#endif
+#if defined(ALLOC_NUM_TENANTS) && (ALLOC_NUM_TENANTS > 0)
+    RUN_TEST(test_tenant_config);
+    RUN_TEST(test_tenant_reservation);
+    RUN_TEST(test_tenant_limit);
+#endif
+#ifdef ALLOC_PRIORITY_RESERVE
+    RUN_TEST(test_prio_reserve);
+#endif
+#ifdef ALLOC_ADDRESS_ORDERED
+    RUN_TEST(test_address_ordered);
+#endif
+#ifdef ALLOC_PREFAULT
+    RUN_TEST(test_prefault_churn);
+#endif
+#ifdef ALLOC_CACHE_COLORING
+    RUN_TEST(test_cache_coloring);
+#endif
+#ifdef ALLOC_REMOTE_FREE
+    RUN_TEST(test_remote_free);
+#endif
+#ifndef ALLOC_WORK_STEALING
+    RUN_TEST(test_contig_alloc);
+    RUN_TEST(test_contig_fragmented);
+#endif
+    RUN_TEST(test_alloc_near);
+    RUN_TEST(test_scope);
+    RUN_TEST(test_reset_all);
+    RUN_TEST(test_scope_reset);
+    RUN_TEST(test_block_refs);
+#ifdef ALLOC_HARD_REALTIME
+    RUN_TEST(test_hard_rt_merge);
+#endif
     return UNITY_END();
 }
\ No newline at end of file